@@ -0,0 +1,1117 @@
+// Headless benchmarks for the simulation core.
+//
+// Usage: snake_bench [benchmark name]
+// Runs every benchmark when no name is given.
+
+// assert()
+#include <assert.h>
+// printf()
+#include <stdio.h>
+// malloc(), free()
+#include <stdlib.h>
+// strcmp()
+#include <string.h>
+#include <chrono>
+
+#include "sim.h"
+#include "sim_batch.h"
+#include "sim_history.h"
+#include "sim_runner.h"
+#include "sim_save.h"
+#include "sim_replay.h"
+#include "sim_compress.h"
+#include "logger.h"
+
+//
+// --- Structs ---
+//
+struct Benchmark {
+    const char *name;
+    const char *description;
+    void (*run)();
+};
+
+//
+// --- Helpers ---
+//
+static volatile u32 bench_sink;
+
+// Every benchmark gets its boards from here.
+static Memory_Arena bench_arena;
+
+static double get_time_seconds() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Makes a state for a board, reusing 'bench_arena'.
+static Sim_State *init_bench_board(int width, int height) {
+    u64 needed = sim_get_memory_size(width, height);
+    if (bench_arena.capacity < needed) {
+        free_memory_arena(&bench_arena);
+        bench_arena = alloc_memory_arena(needed);
+    }
+    clear_memory_arena(&bench_arena);
+    Sim_State *state = sim_init(&bench_arena, width, height);
+    assert(state);
+    return state;
+}
+
+// Hamiltonian cycle over every column except the rightmost one,
+// so anything placed in that column is never reached by the player.
+//
+// Columns are walked up and down over rows [1, height), and row 0
+// is the way back to the start. 'width' must be odd.
+static int make_player_cycle(Vec2i *cycle, int board_width, int board_height) {
+    int width = board_width - 1;
+    int height = board_height;
+    int count = 0;
+    for (int column = width - 1; column >= 0; column--) {
+        bool going_up = ((width - 1 - column) % 2) == 0;
+        For (height - 1) {
+            int row = going_up ? (it + 1) : (height - 1 - it);
+            cycle[count++] = new_vec2i(column, row);
+        }
+    }
+    For (width) {
+        cycle[count++] = new_vec2i(it, 0);
+    }
+    return count;
+}
+
+// Cycle around the edge of the board, leaving the inside free.
+static int make_border_cycle(Vec2i *cycle, int width, int height) {
+    int count = 0;
+    For (width - 1)  cycle[count++] = new_vec2i(it, 0);
+    For (height - 1) cycle[count++] = new_vec2i(width - 1, it);
+    For (width - 1)  cycle[count++] = new_vec2i(width - 1 - it, height - 1);
+    For (height - 1) cycle[count++] = new_vec2i(0, height - 1 - it);
+    return count;
+}
+
+static Sim_Input get_step_input(Vec2i from, Vec2i to) {
+    if (to.x > from.x) return SIM_INPUT_RIGHT;
+    if (to.x < from.x) return SIM_INPUT_LEFT;
+    if (to.y > from.y) return SIM_INPUT_UP;
+    return SIM_INPUT_DOWN;
+}
+
+// Puts player of 'length' tiles on the cycle with its head at cycle[length-1]
+// and moves resource to 'resource_tile', which must be off the cycle.
+static void place_player_on_cycle(Sim_State *state, Vec2i *cycle, int cycle_length, int length, Vec2i resource_tile) {
+    Vec2i *tiles = (Vec2i *) malloc(length * sizeof(Vec2i));
+    For (length) {
+        tiles[it] = cycle[(length - 1 - it + cycle_length) % cycle_length];
+    }
+    sim_reset(state, 1);
+    sim_place_player(state, tiles, length);
+    sim_set_resource(state, sim_tile_index(state, resource_tile));
+    free(tiles);
+}
+
+static Sim_Input *make_cycle_inputs(Vec2i *cycle, int cycle_length) {
+    Sim_Input *inputs = (Sim_Input *) malloc(cycle_length * sizeof(Sim_Input));
+    For (cycle_length) {
+        inputs[it] = get_step_input(cycle[it], cycle[(it + 1) % cycle_length]);
+    }
+    return inputs;
+}
+
+// Walks the player around the cycle, returns seconds per step.
+static double run_steps_on_cycle(Sim_State *state, Sim_Input *inputs, int cycle_length, int length, int steps) {
+    u32 events = 0;
+    int next = length - 1;
+    double start = get_time_seconds();
+    for (int step = 0; step < steps; step++) {
+        events |= sim_step(state, inputs[next]);
+        next = (next + 1 == cycle_length) ? 0 : next + 1;
+    }
+    double elapsed = get_time_seconds() - start;
+    bench_sink += events;
+    assert(!(events & (SIM_EVENT_DIED | SIM_EVENT_RESOURCE_PICKED)));
+    return elapsed / steps;
+}
+
+//
+// --- Benchmarks ---
+//
+static void bench_step_by_length() {
+    static Vec2i cycle[SIM_DEFAULT_BOARD_WIDTH * SIM_DEFAULT_BOARD_HEIGHT];
+    Sim_State *state = init_bench_board(SIM_DEFAULT_BOARD_WIDTH, SIM_DEFAULT_BOARD_HEIGHT);
+    int cycle_length = make_player_cycle(cycle, state->width, state->height);
+    Sim_Input *inputs = make_cycle_inputs(cycle, cycle_length);
+    Vec2i resource_tile = new_vec2i(state->width - 1, state->height / 2);
+
+    const int lengths[] = { 1, 2, 4, 8, 16, 32, 64, 100, cycle_length - 1 };
+    const int steps = 2000000;
+
+    printf("  %dx%d board\n", state->width, state->height);
+    printf("  %8s %12s %12s\n", "length", "ns/tick", "Mticks/s");
+    For (ArrayCount(lengths)) {
+        int length = lengths[it];
+        place_player_on_cycle(state, cycle, cycle_length, length, resource_tile);
+        double seconds = run_steps_on_cycle(state, inputs, cycle_length, length, steps);
+        printf("  %8d %12.2f %12.2f\n", length, seconds * 1e9, 1.0 / seconds / 1e6);
+    }
+    free(inputs);
+}
+
+static void bench_spawn_by_length() {
+    static Vec2i cycle[SIM_DEFAULT_BOARD_WIDTH * SIM_DEFAULT_BOARD_HEIGHT];
+    Sim_State *state = init_bench_board(SIM_DEFAULT_BOARD_WIDTH, SIM_DEFAULT_BOARD_HEIGHT);
+    int cycle_length = make_player_cycle(cycle, state->width, state->height);
+    Vec2i resource_tile = new_vec2i(state->width - 1, state->height / 2);
+
+    const int lengths[] = { 1, 2, 4, 8, 16, 32, 64, 100, cycle_length - 1 };
+    const int spawns = 200000;
+
+    printf("  %dx%d board\n", state->width, state->height);
+    printf("  %8s %12s\n", "length", "ns/spawn");
+    For (ArrayCount(lengths)) {
+        int length = lengths[it];
+        place_player_on_cycle(state, cycle, cycle_length, length, resource_tile);
+
+        double start = get_time_seconds();
+        for (int spawn = 0; spawn < spawns; spawn++) {
+            sim_move_resource_to_rand_pos(state);
+        }
+        double elapsed = get_time_seconds() - start;
+        bench_sink += state->resource;
+
+        printf("  %8d %12.2f\n", length, elapsed * 1e9 / spawns);
+    }
+}
+
+// Same player length on boards from tiny to the largest supported one.
+// Player walks around the edge of the board so its tiles are spread over
+// far apart rows, and the resource waits in the middle.
+static void bench_step_by_area() {
+    const int sides[] = { 8, 16, 64, 256, 1024, 2048, SIM_BOARD_SIDE_MAX };
+    const int length = 24;
+    const int steps = 2000000;
+
+    printf("  %10s %8s %10s %12s %12s %12s\n", "board", "kernel", "MB", "reset ms", "ns/tick", "Mticks/s");
+    For (ArrayCount(sides)) {
+        int side = sides[it];
+        Sim_State *state = init_bench_board(side, side);
+
+        Vec2i *cycle = (Vec2i *) malloc(4 * side * sizeof(Vec2i));
+        int cycle_length = make_border_cycle(cycle, side, side);
+        Sim_Input *inputs = make_cycle_inputs(cycle, cycle_length);
+
+        double start = get_time_seconds();
+        place_player_on_cycle(state, cycle, cycle_length, length, new_vec2i(side / 2, side / 2));
+        double reset_seconds = get_time_seconds() - start;
+
+        double seconds = run_steps_on_cycle(state, inputs, cycle_length, length, steps);
+        printf("  %4dx%-5d %8s %10.2f %12.3f %12.2f %12.2f\n", side, side, sim_get_kernel_name(state->kernel), bench_arena.size / (1024.0 * 1024.0),
+               reset_seconds * 1e3, seconds * 1e9, 1.0 / seconds / 1e6);
+
+        free(inputs);
+        free(cycle);
+    }
+}
+
+// Same walk as 'area', once with the kernel 'sim_init()' picked for the board
+// and once forced to the generic one.
+static void bench_kernels() {
+    const Vec2i shapes[] = {
+        new_vec2i(15, 9), new_vec2i(16, 16), new_vec2i(32, 32), new_vec2i(64, 48),
+        new_vec2i(256, 256), new_vec2i(1024, 1024), new_vec2i(100, 100),
+    };
+    const int length = 24;
+    const int steps = 1000000;
+
+    printf("  %10s %8s %12s %12s %9s\n", "board", "kernel", "generic ns", "picked ns", "speedup");
+    For (ArrayCount(shapes)) {
+        Vec2i shape = shapes[it];
+        Sim_State *state = init_bench_board(shape.x, shape.y);
+        u32 picked = state->kernel;
+
+        Vec2i *cycle = (Vec2i *) malloc(2 * (shape.x + shape.y) * sizeof(Vec2i));
+        int cycle_length = make_border_cycle(cycle, shape.x, shape.y);
+        Sim_Input *inputs = make_cycle_inputs(cycle, cycle_length);
+        Vec2i resource_tile = new_vec2i(shape.x / 2, shape.y / 2);
+
+        // Best of a few interleaved runs, so neither side gets all the warm-up.
+        double generic_seconds = 1e9;
+        double picked_seconds = 1e9;
+        For (5) {
+            state->kernel = SIM_KERNEL_GENERIC;
+            place_player_on_cycle(state, cycle, cycle_length, length, resource_tile);
+            generic_seconds = glm::min(generic_seconds, run_steps_on_cycle(state, inputs, cycle_length, length, steps));
+
+            state->kernel = picked;
+            place_player_on_cycle(state, cycle, cycle_length, length, resource_tile);
+            picked_seconds = glm::min(picked_seconds, run_steps_on_cycle(state, inputs, cycle_length, length, steps));
+        }
+
+        printf("  %4dx%-5d %8s %12.2f %12.2f %8.2fx\n", shape.x, shape.y, sim_get_kernel_name(picked),
+               generic_seconds * 1e9, picked_seconds * 1e9, generic_seconds / picked_seconds);
+
+        free(inputs);
+        free(cycle);
+    }
+}
+
+// Many games on the default board walking the same cycle, each from its own
+// spot on it. Once with 'sim_step()' on separate states, then with every
+// batch kernel the CPU supports. Resource sits off the cycle, so every game
+// keeps moving and none of them dies.
+static void bench_batch() {
+    static Vec2i cycle[SIM_DEFAULT_BOARD_WIDTH * SIM_DEFAULT_BOARD_HEIGHT];
+
+    const int width = SIM_DEFAULT_BOARD_WIDTH;
+    const int height = SIM_DEFAULT_BOARD_HEIGHT;
+    const u32 games_counts[] = { 16, 64, 256, 4096 };
+    const int length = 8;
+    const u64 game_ticks = 50000000;
+
+    int cycle_length = make_player_cycle(cycle, width, height);
+    Sim_Input *cycle_inputs = make_cycle_inputs(cycle, cycle_length);
+    Vec2i tiles[length];
+
+    printf("  %dx%d board, player length %d\n", width, height, length);
+    printf("  %8s %10s %14s %14s\n", "games", "kernel", "ns/game-tick", "Mgame-ticks/s");
+    For (ArrayCount(games_counts)) {
+        u32 games_count = games_counts[it];
+        int ticks = (int)(game_ticks / games_count);
+
+        // Row 't' has every game's input for tick 't', it repeats with the cycle.
+        u8 *inputs = (u8 *) malloc((u64)cycle_length * games_count);
+        u8 *events = (u8 *) malloc(games_count);
+        for (int tick = 0; tick < cycle_length; tick++) {
+            for (u32 game = 0; game < games_count; game++) {
+                int offset = (int)(game % cycle_length);
+                inputs[(u64)tick * games_count + game] = (u8)cycle_inputs[(offset + length - 1 + tick) % cycle_length];
+            }
+        }
+
+        u64 needed = sim_batch_get_memory_size(width, height, games_count) + games_count * sim_get_memory_size(width, height);
+        if (bench_arena.capacity < needed) {
+            free_memory_arena(&bench_arena);
+            bench_arena = alloc_memory_arena(needed);
+        }
+        clear_memory_arena(&bench_arena);
+
+        Sim_Batch batch;
+        Sim_State **states = (Sim_State **) malloc(games_count * sizeof(Sim_State *));
+        bool initialized = sim_batch_init(&batch, &bench_arena, width, height, games_count);
+        for (u32 game = 0; game < games_count; game++) {
+            states[game] = sim_init(&bench_arena, width, height);
+            initialized = initialized && states[game];
+        }
+        assert(initialized);
+        (void)initialized;
+
+        for (u32 game = 0; game < games_count; game++) {
+            int offset = (int)(game % cycle_length);
+            For (length) {
+                tiles[it] = cycle[(offset + length - 1 - it) % cycle_length];
+            }
+            sim_reset(states[game], game + 1);
+            sim_place_player(states[game], tiles, length);
+            sim_set_resource(states[game], sim_tile_index(states[game], new_vec2i(width - 1, height / 2)));
+        }
+
+        // Separate states.
+        u32 all_events = 0;
+        double start = get_time_seconds();
+        for (int tick = 0; tick < ticks; tick++) {
+            u8 *row = inputs + (u64)(tick % cycle_length) * games_count;
+            for (u32 game = 0; game < games_count; game++) {
+                all_events |= sim_step(states[game], (Sim_Input)row[game]);
+            }
+        }
+        double seconds = (get_time_seconds() - start) / ((double)ticks * games_count);
+        assert(!(all_events & (SIM_EVENT_DIED | SIM_EVENT_RESOURCE_PICKED)));
+        bench_sink += all_events;
+        printf("  %8u %10s %14.2f %14.2f\n", games_count, "sim_step", seconds * 1e9, 1.0 / seconds / 1e6);
+
+        for (u32 kernel = 0; kernel < SIM_BATCH_KERNEL_COUNT; kernel++) {
+            if (!sim_batch_kernel_supported(kernel)) {
+                printf("  %8u %10s %14s %14s\n", games_count, sim_batch_get_kernel_name(kernel), "-", "-");
+                continue;
+            }
+
+            // Every kernel starts from the same placement as 'sim_step()' did.
+            for (u32 game = 0; game < games_count; game++) {
+                int offset = (int)(game % cycle_length);
+                For (length) {
+                    tiles[it] = cycle[(offset + length - 1 - it) % cycle_length];
+                }
+                sim_place_player(states[game], tiles, length);
+                sim_batch_set_game(&batch, game, states[game]);
+            }
+            batch.kernel = kernel;
+
+            u8 batch_events = 0;
+            start = get_time_seconds();
+            for (int tick = 0; tick < ticks; tick++) {
+                sim_batch_step(&batch, inputs + (u64)(tick % cycle_length) * games_count, events);
+                batch_events |= events[tick % games_count];
+            }
+            seconds = (get_time_seconds() - start) / ((double)ticks * games_count);
+            assert(!(batch_events & (SIM_EVENT_DIED | SIM_EVENT_RESOURCE_PICKED)));
+            bench_sink += batch_events;
+            printf("  %8u %10s %14.2f %14.2f\n", games_count, sim_batch_get_kernel_name(kernel), seconds * 1e9, 1.0 / seconds / 1e6);
+        }
+
+        free(states);
+        free(events);
+        free(inputs);
+    }
+    free(cycle_inputs);
+}
+
+// Same games at 1, 2, 4 ... threads up to every hardware thread. Game seeds
+// come from game numbers, so every run has to end with the same totals.
+static void bench_scaling() {
+    Sim_Runner_Config config = sim_runner_default_config();
+    config.games_count = 50000;
+
+    int hardware_threads = sim_runner_get_hardware_threads();
+    int threads_counts[32];
+    int runs = 0;
+    for (int threads = 1; threads < hardware_threads && runs < ArrayCount(threads_counts) - 1; threads *= 2) {
+        threads_counts[runs++] = threads;
+    }
+    threads_counts[runs++] = hardware_threads;
+
+    printf("  %dx%d board, %llu games, %u per task, %u per batch, %s kernel, %d hardware threads\n",
+           config.width, config.height, (unsigned long long)config.games_count, config.task_games, config.batch_games,
+           sim_batch_get_kernel_name(sim_batch_pick_kernel()), hardware_threads);
+    printf("  %8s %10s %12s %12s %9s %11s %8s\n", "threads", "seconds", "Mticks/s", "Kgames/s", "speedup", "efficiency", "steals");
+
+    Sim_Runner_Result first = {};
+    For (runs) {
+        config.threads_count = threads_counts[it];
+        Sim_Runner_Result result;
+        bool ran = sim_run_games(&config, &result);
+        assert(ran);
+        (void)ran;
+        if (it == 0) {
+            first = result;
+        }
+        assert(result.games == config.games_count);
+        assert(result.ticks == first.ticks && result.total_score == first.total_score);
+
+        double speedup = first.seconds / result.seconds;
+        printf("  %8d %10.3f %12.2f %12.2f %8.2fx %10.0f%% %8llu\n", result.threads_count, result.seconds,
+               result.ticks / result.seconds / 1e6, result.games / result.seconds / 1e3,
+               speedup, 100.0 * speedup / result.threads_count, (unsigned long long)result.steals);
+    }
+    printf("  average score %.2f, best %d, %llu ticks in total\n", (double)first.total_score / first.games, first.max_score,
+           (unsigned long long)first.ticks);
+}
+
+// FNV-1a over the whole state block, arrays included.
+static u64 hash_state_block(Sim_State *state) {
+    u64 *words = (u64 *)state;
+    u64 hash = 14695981039346656037ull;
+    for (u64 it = 0; it < state->size / sizeof(u64); it++) {
+        hash = (hash ^ words[it]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Snapshot and restore of a whole game with 'sim_copy_state()' on boards from
+// the default one to the largest supported one. Before timing, checks that a
+// game restored from a snapshot plays on exactly like the one it was taken from.
+static void bench_checkpoint() {
+    const Vec2i shapes[] = {
+        new_vec2i(SIM_DEFAULT_BOARD_WIDTH, SIM_DEFAULT_BOARD_HEIGHT), new_vec2i(16, 16), new_vec2i(64, 64),
+        new_vec2i(256, 256), new_vec2i(1024, 1024), new_vec2i(SIM_BOARD_SIDE_MAX, SIM_BOARD_SIDE_MAX),
+    };
+    const int length = 8;
+    const int replay_ticks = 1000;
+    const u64 copied_bytes = 4ull * 1024 * 1024 * 1024; // Per direction, so big boards still get a few copies.
+
+    printf("  %10s %12s %14s %14s %10s\n", "board", "KB", "snapshot ns", "restore ns", "GB/s");
+    For (ArrayCount(shapes)) {
+        Vec2i shape = shapes[it];
+
+        u64 needed = 2 * sim_get_memory_size(shape.x, shape.y);
+        if (bench_arena.capacity < needed) {
+            free_memory_arena(&bench_arena);
+            bench_arena = alloc_memory_arena(needed);
+        }
+        clear_memory_arena(&bench_arena);
+        Sim_State *live = sim_init(&bench_arena, shape.x, shape.y);
+        Sim_State *saved = sim_init(&bench_arena, shape.x, shape.y);
+        assert(live && saved);
+
+        // Resource sits on the cycle ahead of the player, so the replay eats
+        // it and draws new spawns from the random state that was restored.
+        Vec2i *cycle = (Vec2i *) malloc(2 * (shape.x + shape.y) * sizeof(Vec2i));
+        int cycle_length = make_border_cycle(cycle, shape.x, shape.y);
+        Sim_Input *inputs = make_cycle_inputs(cycle, cycle_length);
+        place_player_on_cycle(live, cycle, cycle_length, length, cycle[length + 2]);
+
+        u32 first_events = 0;
+        u32 second_events = 0;
+        sim_copy_state(saved, live);
+        for (int tick = 0; tick < replay_ticks; tick++) {
+            first_events |= sim_step(live, inputs[(length - 1 + tick) % cycle_length]);
+        }
+        u64 first_hash = hash_state_block(live);
+        sim_copy_state(live, saved);
+        for (int tick = 0; tick < replay_ticks; tick++) {
+            second_events |= sim_step(live, inputs[(length - 1 + tick) % cycle_length]);
+        }
+        assert(first_events & SIM_EVENT_RESOURCE_PICKED);
+        assert(first_events == second_events && first_hash == hash_state_block(live));
+        (void)first_hash;
+        (void)second_events;
+
+        u64 copies = glm::clamp(copied_bytes / live->size, (u64)8, (u64)4000000);
+
+        double start = get_time_seconds();
+        for (u64 copy = 0; copy < copies; copy++) {
+            sim_copy_state(saved, live);
+            bench_sink += saved->free_count;
+        }
+        double snapshot_seconds = (get_time_seconds() - start) / copies;
+
+        start = get_time_seconds();
+        for (u64 copy = 0; copy < copies; copy++) {
+            sim_copy_state(live, saved);
+            bench_sink += live->free_count;
+        }
+        double restore_seconds = (get_time_seconds() - start) / copies;
+
+        printf("  %4dx%-5d %12.2f %14.1f %14.1f %10.2f\n", shape.x, shape.y, live->size / 1024.0,
+               snapshot_seconds * 1e9, restore_seconds * 1e9, live->size / restore_seconds / 1e9);
+
+        free(inputs);
+        free(cycle);
+    }
+}
+
+// Save files by board size: the copy the game thread pays for, writing it
+// out, and loading it back by mapping with and without the checksum. Every
+// loaded state is checked to play on like the one that was saved.
+static void bench_save() {
+    const Vec2i shapes[] = {
+        new_vec2i(SIM_DEFAULT_BOARD_WIDTH, SIM_DEFAULT_BOARD_HEIGHT), new_vec2i(64, 64),
+        new_vec2i(256, 256), new_vec2i(1024, 1024), new_vec2i(SIM_BOARD_SIDE_MAX, SIM_BOARD_SIDE_MAX),
+    };
+    const int length = 8;
+    const int replay_ticks = 1000;
+    const int repeats = 5;
+    const char *path = "snake_bench_save.tmp";
+
+    Sim_Compressor compressor;
+    bool compressor_made = sim_init_compressor(&compressor, 1, NULL, 0);
+    assert(compressor_made);
+    (void)compressor_made;
+
+    printf("  %10s %12s %10s %10s %12s %12s %12s %10s %10s\n", "board", "KB", "copy us", "write ms", "map us", "verify ms",
+           "zstd KB", "write ms", "load ms");
+    For (ArrayCount(shapes)) {
+        Vec2i shape = shapes[it];
+
+        u64 needed = 2 * sim_get_memory_size(shape.x, shape.y);
+        if (bench_arena.capacity < needed) {
+            free_memory_arena(&bench_arena);
+            bench_arena = alloc_memory_arena(needed);
+        }
+        clear_memory_arena(&bench_arena);
+        Sim_State *live = sim_init(&bench_arena, shape.x, shape.y);
+        Sim_State *copy = sim_init(&bench_arena, shape.x, shape.y);
+        assert(live && copy);
+
+        Vec2i *cycle = (Vec2i *) malloc(2 * (shape.x + shape.y) * sizeof(Vec2i));
+        int cycle_length = make_border_cycle(cycle, shape.x, shape.y);
+        Sim_Input *inputs = make_cycle_inputs(cycle, cycle_length);
+
+        double copy_seconds = 1e30;
+        double write_seconds = 1e30;
+        double map_seconds = 1e30;
+        double verify_seconds = 1e30;
+        double compressed_write_seconds = 1e30;
+        double compressed_load_seconds = 1e30;
+        u64 compressed_size = 0;
+        for (int repeat = 0; repeat < repeats; repeat++) {
+            place_player_on_cycle(live, cycle, cycle_length, length, cycle[length + 2]);
+
+            double start = get_time_seconds();
+            sim_copy_state(copy, live);
+            copy_seconds = glm::min(copy_seconds, get_time_seconds() - start);
+
+            start = get_time_seconds();
+            u32 written = sim_write_save(path, copy, NULL);
+            write_seconds = glm::min(write_seconds, get_time_seconds() - start);
+            assert(written == SIM_SAVE_OK);
+            (void)written;
+
+            Sim_Save_Mapping mapping;
+            start = get_time_seconds();
+            u32 mapped = sim_map_save(path, &mapping, false);
+            map_seconds = glm::min(map_seconds, get_time_seconds() - start);
+            assert(mapped == SIM_SAVE_OK);
+            sim_unmap_save(&mapping);
+
+            start = get_time_seconds();
+            mapped = sim_map_save(path, &mapping, true);
+            verify_seconds = glm::min(verify_seconds, get_time_seconds() - start);
+            assert(mapped == SIM_SAVE_OK);
+            (void)mapped;
+
+            // Mapped state is played in place, copy-on-write keeps the file as it was.
+            for (int tick = 0; tick < replay_ticks; tick++) {
+                sim_step(live, inputs[(length - 1 + tick) % cycle_length]);
+                sim_step(mapping.state, inputs[(length - 1 + tick) % cycle_length]);
+            }
+            assert(mapping.state->hash == live->hash && hash_state_block(mapping.state) == hash_state_block(live));
+            sim_unmap_save(&mapping);
+
+            // Compressed one loads into memory, the checksum is zstd's.
+            start = get_time_seconds();
+            written = sim_write_save(path, copy, &compressor);
+            compressed_write_seconds = glm::min(compressed_write_seconds, get_time_seconds() - start);
+            assert(written == SIM_SAVE_OK);
+
+            start = get_time_seconds();
+            mapped = sim_map_save(path, &mapping, false);
+            compressed_load_seconds = glm::min(compressed_load_seconds, get_time_seconds() - start);
+            assert(mapped == SIM_SAVE_OK && hash_state_block(mapping.state) == hash_state_block(copy));
+            compressed_size = mapping.size;
+            sim_unmap_save(&mapping);
+        }
+        remove(path);
+
+        printf("  %4dx%-5d %12.2f %10.2f %10.3f %12.1f %12.3f %12.2f %10.3f %10.3f\n", shape.x, shape.y, live->size / 1024.0,
+               copy_seconds * 1e6, write_seconds * 1e3, map_seconds * 1e6, verify_seconds * 1e3,
+               compressed_size / 1024.0, compressed_write_seconds * 1e3, compressed_load_seconds * 1e3);
+        free(inputs);
+        free(cycle);
+    }
+    sim_free_compressor(&compressor);
+}
+
+// Records a long walk on the default board with keyframes at different
+// intervals, then seeks to random frames still in the history. Worst seek
+// replays one interval less one tick.
+static void bench_history() {
+    static Vec2i cycle[SIM_DEFAULT_BOARD_WIDTH * SIM_DEFAULT_BOARD_HEIGHT];
+
+    const int width = SIM_DEFAULT_BOARD_WIDTH;
+    const int height = SIM_DEFAULT_BOARD_HEIGHT;
+    const u32 intervals[] = { 16, 64, 256, 1024 };
+    const u32 keyframes_capacity = 256;
+    const int length = 24;
+    const int ticks = 1000000;
+    const int seeks = 20000;
+
+    printf("  %dx%d board, %u keyframes, %d ticks recorded\n", width, height, keyframes_capacity, ticks);
+    printf("  %10s %12s %10s %12s %12s\n", "interval", "ticks kept", "MB", "record ns", "seek ns");
+    For (ArrayCount(intervals)) {
+        u32 interval = intervals[it];
+
+        u64 needed = sim_get_memory_size(width, height) + sim_history_get_memory_size(width, height, keyframes_capacity, interval);
+        if (bench_arena.capacity < needed) {
+            free_memory_arena(&bench_arena);
+            bench_arena = alloc_memory_arena(needed);
+        }
+        clear_memory_arena(&bench_arena);
+        Sim_State *state = sim_init(&bench_arena, width, height);
+        Sim_History history;
+        bool initialized = state && sim_history_init(&history, &bench_arena, width, height, keyframes_capacity, interval);
+        assert(initialized);
+        (void)initialized;
+
+        int cycle_length = make_player_cycle(cycle, width, height);
+        Sim_Input *inputs = make_cycle_inputs(cycle, cycle_length);
+        place_player_on_cycle(state, cycle, cycle_length, length, new_vec2i(width - 1, height / 2));
+        sim_history_record_change(&history, state);
+
+        // Recording cost on top of 'sim_step()' itself.
+        int next = length - 1;
+        double start = get_time_seconds();
+        for (int tick = 0; tick < ticks; tick++) {
+            sim_step(state, inputs[next]);
+            sim_history_record_tick(&history, state, inputs[next]);
+            next = (next + 1 == cycle_length) ? 0 : next + 1;
+        }
+        double record_seconds = (get_time_seconds() - start) / ticks;
+        u64 latest_hash = state->hash;
+
+        Sim_Rng rng;
+        sim_rng_seed(&rng, 1, 0);
+        u64 kept = history.last_frame - history.first_frame;
+        start = get_time_seconds();
+        for (int seek = 0; seek < seeks; seek++) {
+            u64 frame = history.first_frame + ((u64)sim_rng_next(&rng) % (kept + 1));
+            sim_history_seek(&history, state, frame);
+            bench_sink += (u32)state->hash;
+        }
+        double seek_seconds = (get_time_seconds() - start) / seeks;
+
+        sim_history_seek(&history, state, history.last_frame);
+        assert(state->hash == latest_hash);
+        (void)latest_hash;
+
+        printf("  %10u %12llu %10.2f %12.2f %12.1f\n", interval, (unsigned long long)kept,
+               sim_history_get_memory_used(&history) / (1024.0 * 1024.0), record_seconds * 1e9, seek_seconds * 1e9);
+        free(inputs);
+    }
+}
+
+// Same walk with one log line per tick: none, 'fprintf()' straight to a
+// file, and the asynchronous logger to a file. Ticks the logger had to drop
+// because its ring was full are counted, those ticks still paid for the push.
+static void bench_logging() {
+    static Vec2i cycle[SIM_DEFAULT_BOARD_WIDTH * SIM_DEFAULT_BOARD_HEIGHT];
+
+    const int width = SIM_DEFAULT_BOARD_WIDTH;
+    const int height = SIM_DEFAULT_BOARD_HEIGHT;
+    const int length = 24;
+    const int ticks = 1000000;
+    const char *path = "snake_bench_log.tmp";
+
+    Sim_State *state = init_bench_board(width, height);
+    int cycle_length = make_player_cycle(cycle, width, height);
+    Sim_Input *inputs = make_cycle_inputs(cycle, cycle_length);
+
+    printf("  %dx%d board, %d ticks, one line per tick\n", width, height, ticks);
+    printf("  %-10s %12s %14s %12s\n", "logging", "ns/tick", "ticks/s", "dropped");
+    for (int mode = 0; mode < 3; mode++) {
+        place_player_on_cycle(state, cycle, cycle_length, length, new_vec2i(width - 1, height / 2));
+
+        FILE *file = NULL;
+        if (mode == 1) {
+            file = fopen(path, "wb");
+            assert(file);
+        } else if (mode == 2) {
+            log_start(path, LOG_LEVEL_NONE);
+        }
+        u64 dropped_before = log_get_dropped();
+
+        int next = length - 1;
+        double start = get_time_seconds();
+        for (int tick = 0; tick < ticks; tick++) {
+            sim_step(state, inputs[next]);
+            next = (next + 1 == cycle_length) ? 0 : next + 1;
+
+            Vec2i head = state->player.head;
+            if (mode == 1) {
+                fprintf(file, "[%.2f] - Tick %llu, head at [%d, %d]\n", get_time_seconds() - start,
+                        (unsigned long long)state->tick, head.x, head.y);
+            } else if (mode == 2) {
+                log_write(LOG_LEVEL_INFO, "Tick %llu, head at [%d, %d]", state->tick, head.x, head.y);
+            }
+        }
+        double seconds = (get_time_seconds() - start) / ticks;
+
+        u64 dropped = log_get_dropped() - dropped_before;
+        if (mode == 1) {
+            fclose(file);
+        } else if (mode == 2) {
+            log_stop();
+        }
+        remove(path);
+
+        const char *names[] = { "none", "fprintf", "async" };
+        printf("  %-10s %12.2f %14.0f %12llu\n", names[mode], seconds * 1e9, 1.0 / seconds, (unsigned long long)dropped);
+    }
+    free(inputs);
+}
+
+// Records 100,000 ticks of one game into a replay file and reads them back.
+// Two input patterns: the player walking the default board's cycle, which
+// goes straight for a whole row like real-time play does, and a different
+// random direction every tick like the worst of turn-based play. Recording
+// cost is on top of 'sim_step()', reading is decoding alone.
+static void bench_replay() {
+    static Vec2i cycle[SIM_DEFAULT_BOARD_WIDTH * SIM_DEFAULT_BOARD_HEIGHT];
+    static Sim_Replay_Writer writer;
+
+    const int width = SIM_DEFAULT_BOARD_WIDTH;
+    const int height = SIM_DEFAULT_BOARD_HEIGHT;
+    const int length = 24;
+    const int ticks = 100000;
+    const char *path = "snake_bench_replay.tmp";
+
+    Sim_State *state = init_bench_board(width, height);
+    int cycle_length = make_player_cycle(cycle, width, height);
+    Sim_Input *cycle_inputs = make_cycle_inputs(cycle, cycle_length);
+    Sim_Input *inputs = (Sim_Input *) malloc(ticks * sizeof(Sim_Input));
+    u8 *file_data = NULL;
+
+    printf("  %dx%d board, %d ticks\n", width, height, ticks);
+    printf("  %-8s %12s %12s %14s %14s\n", "inputs", "bytes", "bits/tick", "record ns", "read ns");
+    for (int pattern = 0; pattern < 2; pattern++) {
+        Sim_Rng rng;
+        sim_rng_seed(&rng, 7, 0);
+        For (ticks) {
+            inputs[it] = (pattern == 0) ? cycle_inputs[(length - 1 + it) % cycle_length] : (Sim_Input)(SIM_INPUT_UP + sim_rng_next(&rng) % 4);
+        }
+
+        place_player_on_cycle(state, cycle, cycle_length, length, new_vec2i(width - 1, height / 2));
+        bool opened = sim_replay_open(&writer, path, 0, NULL, 0);
+        assert(opened);
+        (void)opened;
+        sim_replay_begin_game(&writer, state);
+
+        // Random inputs would kill the player, so that pattern only records.
+        double start = get_time_seconds();
+        For (ticks) {
+            if (pattern == 0) {
+                sim_step(state, inputs[it]);
+            }
+            sim_replay_record_input(&writer, state, inputs[it]);
+        }
+        double record_seconds = (get_time_seconds() - start) / ticks;
+        sim_replay_end_game(&writer, state, SIM_REPLAY_END_ABANDONED);
+        sim_replay_close(&writer);
+
+        FILE *file = fopen(path, "rb");
+        assert(file);
+        fseek(file, 0, SEEK_END);
+        long file_size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        file_data = (u8 *) realloc(file_data, file_size);
+        size_t read = fread(file_data, 1, file_size, file);
+        assert(read == (size_t)file_size);
+        (void)read;
+        fclose(file);
+        remove(path);
+
+        Sim_Replay_Reader reader;
+        Sim_Replay_Entry entry;
+        bool valid = sim_replay_open_reader(&reader, file_data, file_size);
+        assert(valid);
+        (void)valid;
+        int decoded = 0;
+        u32 mismatches = 0;
+        start = get_time_seconds();
+        while (sim_replay_read(&reader, &entry) > SIM_REPLAY_ENTRY_ERROR) {
+            if (entry.kind == SIM_REPLAY_ENTRY_RUN) {
+                for (u32 at = 0; at < entry.count; at++) {
+                    mismatches += (decoded < ticks) ? (inputs[decoded] != entry.input) : 1;
+                    decoded++;
+                }
+            } else if (entry.kind == SIM_REPLAY_ENTRY_GROUP) {
+                for (u32 at = 0; at < entry.count; at++) {
+                    mismatches += (decoded < ticks) ? (inputs[decoded] != sim_replay_get_packed_input(entry.packed, at)) : 1;
+                    decoded++;
+                }
+            }
+        }
+        double read_seconds = (get_time_seconds() - start) / ticks;
+        assert(entry.kind == SIM_REPLAY_ENTRY_END && decoded == ticks && mismatches == 0);
+
+        const char *names[] = { "cycle", "random" };
+        printf("  %-8s %12ld %12.3f %14.2f %14.2f\n", names[pattern], file_size, file_size * 8.0 / ticks,
+               record_seconds * 1e9, read_seconds * 1e9);
+    }
+    free(file_data);
+    free(inputs);
+    free(cycle_inputs);
+}
+
+// Records one long game, the player walking a cycle that leaves out the
+// rightmost column and so never ending, then goes to random ticks of it
+// through the keyframe index and by playing from the game's start.
+static void bench_seek() {
+    static Sim_Replay_Writer writer;
+
+    const int width = 65;
+    const int height = 64;
+    const int ticks = 4000000;
+    const int seeks = 40;
+    const char *path = "snake_bench_seek.tmp";
+
+    Vec2i *cycle = (Vec2i *) malloc(width * height * sizeof(Vec2i));
+    int cycle_length = make_player_cycle(cycle, width, height);
+    Sim_Input *inputs = make_cycle_inputs(cycle, cycle_length);
+    Sim_State *state = init_bench_board(width, height);
+    sim_reset(state, 3);
+    int next = 0;
+    while (!(cycle[next].x == state->player.head.x && cycle[next].y == state->player.head.y)) {
+        next++;
+    }
+
+    bool opened = sim_replay_open(&writer, path, 0, NULL, 0);
+    assert(opened);
+    (void)opened;
+    sim_replay_begin_game(&writer, state);
+    double start = get_time_seconds();
+    For (ticks) {
+        u32 events = sim_step(state, inputs[next]);
+        sim_replay_record_input(&writer, state, inputs[next]);
+        next = (next + 1 == cycle_length) ? 0 : next + 1;
+        assert(!(events & (SIM_EVENT_DIED | SIM_EVENT_WON)));
+        (void)events;
+    }
+    double record_seconds = (get_time_seconds() - start) / ticks;
+    sim_replay_end_game(&writer, state, SIM_REPLAY_END_ABANDONED);
+    sim_replay_close(&writer);
+    u64 keyframes = writer.index_keyframes_count;
+    u64 keyframe_interval = writer.keyframe_interval;
+
+    FILE *file = fopen(path, "rb");
+    assert(file);
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    u8 *file_data = (u8 *) malloc(file_size);
+    size_t read = fread(file_data, 1, file_size, file);
+    assert(read == (size_t)file_size);
+    (void)read;
+    fclose(file);
+    remove(path);
+
+    printf("  %dx%d board, one game of %d ticks, %.2f ns/tick to record\n", width, height, ticks, record_seconds * 1e9);
+    printf("  %ld bytes, %llu of them in %llu keyframes every %llu ticks\n", file_size,
+           (unsigned long long)(keyframes * state->size), (unsigned long long)keyframes, (unsigned long long)keyframe_interval);
+
+    Sim_Replay_Reader reader;
+    Sim_Replay_Index index;
+    bool valid = sim_replay_open_reader(&reader, file_data, file_size) && reader.index && sim_replay_load_index(&index, &reader);
+    assert(valid);
+    (void)valid;
+    printf("  %-16s %12s %12s\n", "seek", "average ms", "worst ms");
+    u64 hashes[seeks];
+    For (2) {
+        Sim_Rng rng;
+        sim_rng_seed(&rng, 5, 0);
+        double total = 0.0;
+        double worst = 0.0;
+        for (int seek = 0; seek < seeks; seek++) {
+            u64 tick = sim_rng_bounded(&rng, ticks + 1);
+            Sim_Replay_Cursor cursor;
+            start = get_time_seconds();
+            bool sought = sim_replay_seek(&cursor, &reader, &index, 0, tick, state, it == 0);
+            double seconds = get_time_seconds() - start;
+            assert(sought && cursor.tick == tick);
+            (void)sought;
+            total += seconds;
+            worst = (seconds > worst) ? seconds : worst;
+            if (it == 0) {
+                hashes[seek] = state->hash;
+            }
+            assert(state->hash == hashes[seek]);
+        }
+        printf("  %-16s %12.3f %12.3f\n", (it == 0) ? "keyframes" : "from the start", total * 1e3 / seeks, worst * 1e3);
+    }
+    sim_replay_free_index(&index);
+    free(file_data);
+    free(inputs);
+    free(cycle);
+}
+
+// Heads for the resource when that's safe, else takes any safe way.
+static Sim_Input get_greedy_input(Sim_State *state, Sim_Rng *rng) {
+    Vec2i head = state->player.head;
+    Vec2i resource = (state->resource != SIM_NO_RESOURCE) ? sim_index_tile(state, state->resource) : head;
+    Sim_Input wanted = SIM_INPUT_NONE;
+    if (resource.x != head.x) {
+        wanted = (resource.x > head.x) ? SIM_INPUT_RIGHT : SIM_INPUT_LEFT;
+    } else if (resource.y != head.y) {
+        wanted = (resource.y > head.y) ? SIM_INPUT_UP : SIM_INPUT_DOWN;
+    }
+
+    Sim_Input safe[4];
+    int safe_count = 0;
+    For (4) {
+        Sim_Input input = (Sim_Input)(SIM_INPUT_UP + it);
+        Vec2i direction = sim_input_direction(input);
+        Vec2i tile = new_vec2i(head.x + direction.x, head.y + direction.y);
+        if (sim_tile_in_bounds(state, tile) && !sim_tile_occupied(state, sim_tile_index(state, tile))) {
+            if (input == wanted) {
+                return input;
+            }
+            safe[safe_count++] = input;
+        }
+    }
+    return safe_count ? safe[sim_rng_bounded(rng, safe_count)] : SIM_INPUT_UP;
+}
+
+// Records a session of short greedy games on the default board, then packs
+// them one game per file like a leaderboard would get them: raw, zstd, and
+// zstd with a dictionary trained on a separate part of the session. Also the
+// whole session compressed as it's recorded. Decompression is what bulk
+// verification pays per game on top of playing it.
+static void bench_zstd() {
+    static Sim_Replay_Writer writer;
+
+    const int width = SIM_DEFAULT_BOARD_WIDTH;
+    const int height = SIM_DEFAULT_BOARD_HEIGHT;
+    const int games = 4000;
+    const int training_games = 3000;
+    const char *path = "snake_bench_zstd.tmp";
+
+    Sim_State *state = init_bench_board(width, height);
+    Sim_Rng rng;
+    sim_rng_seed(&rng, 11, 0);
+
+    u64 session_sizes[2] = {};
+    u8 *session = NULL;
+    For (2) {
+        int level = (it == 0) ? 0 : SIM_COMPRESSION_LEVEL_DEFAULT;
+        bool opened = sim_replay_open(&writer, path, level, NULL, 0);
+        assert(opened);
+        (void)opened;
+        sim_rng_seed(&rng, 11, 0);
+        for (int game = 0; game < games; game++) {
+            sim_reset(state, game);
+            sim_replay_begin_game(&writer, state);
+            u32 events = 0;
+            while (!(events & (SIM_EVENT_DIED | SIM_EVENT_WON))) {
+                Sim_Input input = get_greedy_input(state, &rng);
+                events = sim_step(state, input);
+                sim_replay_record_input(&writer, state, input);
+            }
+            sim_replay_end_game(&writer, state, (events & SIM_EVENT_WON) ? SIM_REPLAY_END_WON : SIM_REPLAY_END_DIED);
+        }
+        sim_replay_close(&writer);
+
+        FILE *file = fopen(path, "rb");
+        assert(file);
+        fseek(file, 0, SEEK_END);
+        session_sizes[it] = (u64)ftell(file);
+        fseek(file, 0, SEEK_SET);
+        if (it == 0) {
+            session = (u8 *) malloc((size_t)session_sizes[it]);
+            size_t read = fread(session, 1, (size_t)session_sizes[it], file);
+            assert(read == session_sizes[it]);
+            (void)read;
+        }
+        fclose(file);
+        remove(path);
+    }
+    printf("  %dx%d board, %d greedy games, %llu ticks\n", width, height, games, (unsigned long long)writer.ticks);
+    printf("  whole session: %llu bytes raw, %llu with zstd as it's recorded\n",
+           (unsigned long long)session_sizes[0], (unsigned long long)session_sizes[1]);
+
+    // Every game as a replay of its own, header included.
+    u8 *files = (u8 *) malloc((size_t)(session_sizes[0] + games * sizeof(Sim_Replay_File_Header)));
+    u64 *file_sizes = (u64 *) malloc(games * sizeof(u64));
+    Sim_Replay_Reader reader;
+    bool valid = sim_replay_open_reader(&reader, session, session_sizes[0]);
+    assert(valid);
+    (void)valid;
+    u64 files_size = 0;
+    u64 begin, end;
+    int game = 0;
+    while (game < games && sim_replay_find_game(&reader, &begin, &end)) {
+        memcpy(files + files_size, session, sizeof(Sim_Replay_File_Header));
+        memcpy(files + files_size + sizeof(Sim_Replay_File_Header), session + begin, (size_t)(end - begin));
+        file_sizes[game] = sizeof(Sim_Replay_File_Header) + end - begin;
+        files_size += file_sizes[game];
+        game++;
+    }
+    assert(game == games);
+
+    u8 *dictionary = (u8 *) malloc((size_t)SIM_DICTIONARY_SIZE_DEFAULT);
+    double start = get_time_seconds();
+    u64 dictionary_size = sim_train_dictionary(dictionary, SIM_DICTIONARY_SIZE_DEFAULT, files, file_sizes, training_games);
+    double training_seconds = get_time_seconds() - start;
+    assert(dictionary_size > 0);
+    printf("  dictionary: %llu bytes from %d games in %.0f ms\n", (unsigned long long)dictionary_size, training_games,
+           training_seconds * 1e3);
+
+    const u64 buffer_size = 64 * 1024;
+    u8 *compressed = (u8 *) malloc((size_t)buffer_size);
+    u8 *decompressed = (u8 *) malloc((size_t)buffer_size);
+    printf("  %-20s %14s %10s %16s %16s\n", "test games", "bytes/game", "ratio", "compress us", "decompress us");
+    For (3) {
+        Sim_Compressor compressor = {};
+        Sim_Decompressor decompressor = {};
+        if (it > 0) {
+            const void *used = (it == 2) ? dictionary : NULL;
+            bool made = sim_init_compressor(&compressor, SIM_COMPRESSION_LEVEL_DEFAULT, used, dictionary_size) &&
+                        sim_init_decompressor(&decompressor, used, dictionary_size);
+            assert(made);
+            (void)made;
+        }
+
+        u64 raw_total = 0;
+        u64 packed_total = 0;
+        double compress_seconds = 0.0;
+        double decompress_seconds = 0.0;
+        u64 offset = 0;
+        for (game = 0; game < games; game++) {
+            u8 *file = files + offset;
+            offset += file_sizes[game];
+            if (game < training_games) {
+                continue;
+            }
+            raw_total += file_sizes[game];
+            if (it == 0) {
+                packed_total += file_sizes[game];
+                continue;
+            }
+
+            start = get_time_seconds();
+            u64 size = sim_compress(&compressor, compressed, buffer_size, file, file_sizes[game]);
+            compress_seconds += get_time_seconds() - start;
+            assert(size > 0);
+            packed_total += size;
+
+            start = get_time_seconds();
+            u64 unpacked = sim_decompress(&decompressor, decompressed, buffer_size, compressed, size);
+            decompress_seconds += get_time_seconds() - start;
+            assert(unpacked == file_sizes[game] && memcmp(decompressed, file, (size_t)unpacked) == 0);
+            (void)unpacked;
+        }
+        if (it > 0) {
+            sim_free_compressor(&compressor);
+            sim_free_decompressor(&decompressor);
+        }
+
+        const char *names[] = { "raw", "zstd", "zstd + dictionary" };
+        int tested = games - training_games;
+        printf("  %-20s %14.1f %10.2f %16.2f %16.2f\n", names[it], (double)packed_total / tested, (double)raw_total / packed_total,
+               compress_seconds * 1e6 / tested, decompress_seconds * 1e6 / tested);
+    }
+
+    free(decompressed);
+    free(compressed);
+    free(dictionary);
+    free(file_sizes);
+    free(files);
+    free(session);
+}
+
+static Benchmark benchmarks[] = {
+    { "step", "sim_step() cost by player length", bench_step_by_length },
+    { "spawn", "Resource spawn cost by player length", bench_spawn_by_length },
+    { "area", "sim_step() cost by board area", bench_step_by_area },
+    { "kernels", "Specialized sim_step() kernels against the generic one", bench_kernels },
+    { "batch", "Lockstep batch of games against sim_step() on each", bench_batch },
+    { "scaling", "Work-stealing batch runner at 1, 2, 4 ... threads", bench_scaling },
+    { "checkpoint", "Whole game snapshot and restore by board size", bench_checkpoint },
+    { "save", "Save file write and mapped load by board size", bench_save },
+    { "replay", "Replay recording size and cost, 100,000 ticks", bench_replay },
+    { "zstd", "Replay compression with and without a trained dictionary", bench_zstd },
+    { "seek", "Replay seek through keyframes against playing from the start", bench_seek },
+    { "history", "Time-travel history recording and seek cost by keyframe interval", bench_history },
+    { "logging", "Tick rate with a log line per tick, printf against the async logger", bench_logging },
+};
+
+int main(int arguments_count, char **arguments) {
+    const char *filter = (arguments_count > 1) ? arguments[1] : NULL;
+
+    int ran = 0;
+    For (ArrayCount(benchmarks)) {
+        Benchmark *bench = &benchmarks[it];
+        if (filter && strcmp(filter, bench->name) != 0) continue;
+
+        printf("[%s] %s\n", bench->name, bench->description);
+        bench->run();
+        printf("\n");
+        ran++;
+    }
+
+    if (ran == 0) {
+        printf("Unknown benchmark '%s'. Available:\n", filter);
+        For (ArrayCount(benchmarks)) {
+            printf("  %-10s %s\n", benchmarks[it].name, benchmarks[it].description);
+        }
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,133 @@
+// Turns a binary log written by 'log_start()' back into text.
+//
+// Usage: snake_log_decode <log file> [minimum level]
+// Prints every record, '[seconds] [thread] LEVEL - message', in the order
+// the background thread wrote them, which is per thread in time order.
+
+// printf(), fopen(), fread()
+#include <stdio.h>
+// malloc(), realloc(), free(), atoi()
+#include <stdlib.h>
+// memset()
+#include <string.h>
+
+#include "logger.h"
+
+//
+// --- Structs ---
+//
+
+// Format texts by id, as the file defines them.
+struct Log_Formats {
+    char **texts;
+    u32 count;
+    u32 capacity;
+};
+
+//
+// --- Helpers ---
+//
+static bool add_format(Log_Formats *formats, u32 id, char *text) {
+    if (id >= formats->capacity) {
+        u32 capacity = formats->capacity ? formats->capacity * 2 : 64;
+        while (capacity <= id) capacity *= 2;
+        char **texts = (char **) realloc(formats->texts, capacity * sizeof(char *));
+        if (!texts) {
+            return false;
+        }
+        memset(texts + formats->capacity, 0, (capacity - formats->capacity) * sizeof(char *));
+        formats->texts = texts;
+        formats->capacity = capacity;
+    }
+    free(formats->texts[id]);
+    formats->texts[id] = text;
+    if (id >= formats->count) {
+        formats->count = id + 1;
+    }
+    return true;
+}
+
+static void free_formats(Log_Formats *formats) {
+    for (u32 id = 0; id < formats->count; id++) {
+        free(formats->texts[id]);
+    }
+    free(formats->texts);
+}
+
+int main(int arguments_count, char **arguments) {
+    if (arguments_count < 2) {
+        printf("Usage: snake_log_decode <log file> [minimum level 0-3]\n");
+        return 1;
+    }
+    u32 min_level = (arguments_count > 2) ? (u32)atoi(arguments[2]) : LOG_LEVEL_DEBUG;
+
+    FILE *file = fopen(arguments[1], "rb");
+    if (!file) {
+        printf("Couldn't open '%s'.\n", arguments[1]);
+        return 1;
+    }
+
+    Log_File_Header header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != LOG_FILE_MAGIC) {
+        printf("'%s' isn't a snake log.\n", arguments[1]);
+        fclose(file);
+        return 1;
+    }
+    if (header.version != LOG_FILE_VERSION || header.record_size != sizeof(Log_File_Record)) {
+        printf("'%s' is log version %u with %u-byte records, this decoder reads version %u with %u-byte ones.\n",
+               arguments[1], header.version, header.record_size, LOG_FILE_VERSION, (u32)sizeof(Log_File_Record));
+        fclose(file);
+        return 1;
+    }
+    printf("Log started at unix time %llu.\n", (unsigned long long)header.start_unix_time);
+
+    Log_Formats formats = {};
+    Log_File_Record entry;
+    u64 records = 0;
+    bool truncated = false;
+    while (true) {
+        size_t read = fread(&entry, 1, sizeof(entry), file);
+        if (read != sizeof(entry)) {
+            truncated = read > 0;
+            break;
+        }
+        if (entry.entry == LOG_ENTRY_FORMAT) {
+            u64 length = entry.args[0];
+            char *text = (char *) malloc(length + 1);
+            if (!text || fread(text, 1, length, file) != length) {
+                free(text);
+                truncated = true;
+                break;
+            }
+            text[length] = '\0';
+            if (!add_format(&formats, entry.format_id, text)) {
+                free(text);
+                truncated = true;
+                break;
+            }
+            continue;
+        }
+
+        records++;
+        if (entry.level < min_level) {
+            continue;
+        }
+        const char *format = (entry.format_id < formats.count) ? formats.texts[entry.format_id] : NULL;
+        char message[1024];
+        if (format) {
+            u32 args_count = entry.args_count < LOG_ARGS_MAX ? entry.args_count : LOG_ARGS_MAX;
+            log_format_record(message, sizeof(message), format, entry.args, args_count);
+        } else {
+            snprintf(message, sizeof(message), "<unknown format %u>", entry.format_id);
+        }
+        printf("[%12.6f] [%2u] %-7s - %s\n", entry.time_ns / 1e9, entry.thread, log_get_level_name(entry.level), message);
+    }
+    if (truncated) {
+        printf("Log ends in the middle of an entry, the program writing it probably didn't stop cleanly.\n");
+    }
+    printf("%llu records.\n", (unsigned long long)records);
+
+    free_formats(&formats);
+    fclose(file);
+    return 0;
+}
@@ -0,0 +1,422 @@
+// assert()
+#include <assert.h>
+// fopen(), fwrite(), snprintf()
+#include <stdio.h>
+// malloc()
+#include <stdlib.h>
+// time()
+#include <time.h>
+// placement new
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <tracy/Tracy.hpp>
+
+#include "logger.h"
+#include "spsc_queue.h"
+
+//
+// --- Constants ---
+//
+const u32 LOG_FORMATS_MAX = 1024;       // Format addresses, power of two. Past half of it records only go to the console.
+const u32 LOG_FILE_BUFFER_SIZE = 64 * 1024;
+const int LOG_FLUSH_INTERVAL_MS = 100;  // File is flushed this often while records keep coming.
+const u16 LOG_THREAD_LOGGER = LOG_THREADS_MAX;  // Thread number of the logger's own records.
+const char *LOG_DROPPED_FORMAT = "Dropped %llu log records, a thread logged faster than they were written.";
+
+//
+// --- Structs ---
+//
+
+// One per thread that ever logged. Never freed, a thread can exit with
+// records still in it.
+struct Log_Ring {
+    Spsc_Queue<Log_Record, LOG_RING_CAPACITY> queue;
+    std::atomic<u64> dropped{0};
+};
+
+// Background thread only. Maps format addresses to the ids in the file.
+struct Log_Format_Table {
+    const char *formats[LOG_FORMATS_MAX];
+    u32 ids[LOG_FORMATS_MAX];
+    u32 count;
+};
+
+//
+// --- Global variables ---
+//
+static const std::chrono::steady_clock::time_point log_start_time = std::chrono::steady_clock::now();
+
+static std::atomic<Log_Ring *> log_rings[LOG_THREADS_MAX];
+static std::atomic<int> log_rings_count{0};
+static std::atomic<u64> log_unregistered_dropped{0}; // Threads past LOG_THREADS_MAX.
+static thread_local Log_Ring *log_thread_ring = NULL;
+static thread_local bool log_thread_registered = false;
+
+static std::thread log_thread;
+static std::atomic<bool> log_running{false};
+static std::atomic<u32> log_console_level{LOG_LEVEL_INFO};
+static FILE *log_file = NULL;           // Background thread only while it runs.
+static Log_Format_Table log_formats;    // Background thread only.
+static u64 log_dropped_written = 0;     // Background thread only.
+
+// Entries collect here and go to the file in one 'fwrite()', background thread only.
+static u8 log_file_buffer[LOG_FILE_BUFFER_SIZE];
+static u32 log_file_buffer_used = 0;
+
+//
+// --- Helpers ---
+//
+static int get_rings_count() {
+    int count = log_rings_count.load(std::memory_order_acquire);
+    return count < LOG_THREADS_MAX ? count : LOG_THREADS_MAX;
+}
+
+static Log_Ring *get_thread_ring() {
+    if (log_thread_registered) {
+        return log_thread_ring;
+    }
+    log_thread_registered = true;
+
+    int index = log_rings_count.fetch_add(1, std::memory_order_relaxed);
+    if (index >= LOG_THREADS_MAX) {
+        return NULL;
+    }
+    // Queue indices are cache line aligned, more than malloc() promises.
+    void *memory = malloc(sizeof(Log_Ring) + 63);
+    if (!memory) {
+        return NULL;
+    }
+    log_thread_ring = new ((void *)(((uintptr_t)memory + 63) & ~(uintptr_t)63)) Log_Ring();
+    log_rings[index].store(log_thread_ring, std::memory_order_release);
+    return log_thread_ring;
+}
+
+static void flush_file_buffer() {
+    if (log_file && log_file_buffer_used > 0) {
+        fwrite(log_file_buffer, 1, log_file_buffer_used, log_file);
+        fflush(log_file);
+    }
+    log_file_buffer_used = 0;
+}
+
+static void write_to_file(const void *data, u64 size) {
+    if (!log_file) {
+        return;
+    }
+    if (log_file_buffer_used + size > LOG_FILE_BUFFER_SIZE) {
+        fwrite(log_file_buffer, 1, log_file_buffer_used, log_file);
+        log_file_buffer_used = 0;
+        if (size > LOG_FILE_BUFFER_SIZE) {
+            fwrite(data, 1, (size_t)size, log_file);
+            return;
+        }
+    }
+    memcpy(log_file_buffer + log_file_buffer_used, data, (size_t)size);
+    log_file_buffer_used += (u32)size;
+}
+
+// Writes the format's definition the first time it's seen. Returns U32_MAX
+// when the table is full.
+static u32 get_format_id(const char *format) {
+    u32 slot = (u32)(((uintptr_t)format >> 3) * 0x9E3779B1u) & (LOG_FORMATS_MAX - 1);
+    for (u32 probe = 0; probe < LOG_FORMATS_MAX; probe++) {
+        if (log_formats.formats[slot] == format) {
+            return log_formats.ids[slot];
+        }
+        if (!log_formats.formats[slot]) {
+            if (log_formats.count == LOG_FORMATS_MAX / 2) {
+                return U32_MAX;
+            }
+            u32 id = log_formats.count++;
+            log_formats.formats[slot] = format;
+            log_formats.ids[slot] = id;
+
+            Log_File_Record definition = {};
+            definition.entry = LOG_ENTRY_FORMAT;
+            definition.format_id = id;
+            definition.args[0] = strlen(format);
+            write_to_file(&definition, sizeof(definition));
+            write_to_file(format, definition.args[0]);
+            return id;
+        }
+        slot = (slot + 1) & (LOG_FORMATS_MAX - 1);
+    }
+    return U32_MAX;
+}
+
+static void write_record(Log_Record *record, u16 thread) {
+    u32 format_id = get_format_id(record->format);
+
+    if (format_id != U32_MAX) {
+        Log_File_Record entry = {};
+        entry.entry = LOG_ENTRY_RECORD;
+        entry.format_id = format_id;
+        entry.time_ns = record->time_ns;
+        entry.level = record->level;
+        entry.args_count = record->args_count;
+        entry.thread = thread;
+        memcpy(entry.args, record->args, sizeof(entry.args));
+        write_to_file(&entry, sizeof(entry));
+    }
+
+    if (record->level >= log_console_level.load(std::memory_order_relaxed)) {
+        char message[1024];
+        log_format_record(message, sizeof(message), record->format, record->args, record->args_count);
+        if (record->level >= LOG_LEVEL_WARNING) {
+            printf("[%.2f] - %s: %s\n", record->time_ns / 1e9, log_get_level_name(record->level), message);
+        } else {
+            printf("[%.2f] - %s\n", record->time_ns / 1e9, message);
+        }
+    }
+}
+
+// Records lost since the last call become a warning of their own.
+static void write_dropped_note(u16 thread) {
+    u64 dropped = log_get_dropped();
+    if (dropped == log_dropped_written) {
+        return;
+    }
+
+    Log_Record note = {};
+    note.time_ns = log_get_time_ns();
+    note.format = LOG_DROPPED_FORMAT;
+    note.level = LOG_LEVEL_WARNING;
+    note.args_count = 1;
+    note.args[0] = dropped - log_dropped_written;
+    log_dropped_written = dropped;
+    write_record(&note, thread);
+}
+
+// Drains every ring, a few records at a time from each so one busy thread
+// doesn't hold the others back. Returns how many records were written.
+static u64 drain_rings() {
+    ZoneScoped;
+
+    u64 written = 0;
+    int count = get_rings_count();
+    for (int thread = 0; thread < count; thread++) {
+        Log_Ring *ring = log_rings[thread].load(std::memory_order_acquire);
+        if (!ring) {
+            continue; // Registered but not published yet, next pass gets it.
+        }
+        Log_Record record;
+        for (u32 taken = 0; taken < LOG_RING_CAPACITY / 4 && spsc_pop(&ring->queue, &record); taken++) {
+            write_record(&record, (u16)thread);
+            written++;
+        }
+    }
+    write_dropped_note(LOG_THREAD_LOGGER);
+    return written;
+}
+
+static void log_thread_main() {
+    auto last_flush = std::chrono::steady_clock::now();
+    bool unflushed = false;
+
+    while (true) {
+        bool running = log_running.load(std::memory_order_acquire);
+        u64 written = drain_rings();
+        unflushed |= written > 0;
+
+        auto now = std::chrono::steady_clock::now();
+        if (unflushed && (written == 0 || now - last_flush >= std::chrono::milliseconds(LOG_FLUSH_INTERVAL_MS))) {
+            flush_file_buffer();
+            fflush(stdout);
+            last_flush = now;
+            unflushed = false;
+        }
+
+        if (written == 0) {
+            // Rings were read after 'running' was, so nothing logged before 'log_stop()' is left.
+            if (!running) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+//
+// --- Functions ---
+//
+
+// Starts the background thread. 'file_path' may be NULL for console only,
+// records below 'console_level' only go to the file. Returns false if the
+// file couldn't be opened, the console still gets everything then.
+bool log_start(const char *file_path, u32 console_level) {
+    ZoneScoped;
+
+    assert(!log_running.load());
+
+    bool opened = true;
+    log_console_level.store(console_level, std::memory_order_relaxed);
+    memset(&log_formats, 0, sizeof(log_formats));
+    log_dropped_written = log_get_dropped();
+
+    log_file_buffer_used = 0;
+    log_file = file_path ? fopen(file_path, "wb") : NULL;
+    if (log_file) {
+        Log_File_Header header = {};
+        header.magic = LOG_FILE_MAGIC;
+        header.version = LOG_FILE_VERSION;
+        header.record_size = sizeof(Log_File_Record);
+        header.start_unix_time = (u64)time(NULL) - log_get_time_ns() / 1000000000ull;
+        fwrite(&header, sizeof(header), 1, log_file);
+    } else if (file_path) {
+        opened = false;
+    }
+
+    log_running.store(true, std::memory_order_release);
+    log_thread = std::thread(log_thread_main);
+
+    if (!opened) {
+        LOG_WARNING("Couldn't open the log file, logging to console only.");
+    }
+    return opened;
+}
+
+// Writes out everything logged so far and stops the background thread.
+void log_stop() {
+    ZoneScoped;
+
+    if (!log_running.load()) {
+        return;
+    }
+    log_running.store(false, std::memory_order_release);
+    log_thread.join();
+
+    flush_file_buffer();
+    if (log_file) {
+        fclose(log_file);
+        log_file = NULL;
+    }
+}
+
+// Any thread. Never blocks, drops the record when the thread's ring is full.
+void log_push(Log_Record *record) {
+    Log_Ring *ring = get_thread_ring();
+    if (!ring) {
+        log_unregistered_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (!spsc_push(&ring->queue, *record)) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+u64 log_get_time_ns() {
+    using namespace std::chrono;
+    return (u64)duration_cast<nanoseconds>(steady_clock::now() - log_start_time).count();
+}
+
+// Records lost to full rings since the program started.
+u64 log_get_dropped() {
+    u64 dropped = log_unregistered_dropped.load(std::memory_order_relaxed);
+    int count = get_rings_count();
+    for (int thread = 0; thread < count; thread++) {
+        Log_Ring *ring = log_rings[thread].load(std::memory_order_acquire);
+        if (ring) {
+            dropped += ring->dropped.load(std::memory_order_relaxed);
+        }
+    }
+    return dropped;
+}
+
+const char *log_get_level_name(u32 level) {
+    switch (level) {
+        case LOG_LEVEL_DEBUG:   return "DEBUG";
+        case LOG_LEVEL_INFO:    return "INFO";
+        case LOG_LEVEL_WARNING: return "WARNING";
+        case LOG_LEVEL_ERROR:   return "ERROR";
+    }
+    return "UNKNOWN";
+}
+
+// printf() with packed arguments, used by the background thread and the
+// decoder. Integer conversions without a length take 32 bits, with any
+// length 64. Missing arguments and '%s' print as '?'. Returns the length
+// written, cut to fit 'buffer'.
+int log_format_record(char *buffer, int buffer_size, const char *format, const u64 *args, u32 args_count) {
+    assert(buffer_size > 0);
+
+    int length = 0;
+    u32 next_arg = 0;
+    const char *at = format;
+
+    while (*at && length < buffer_size - 1) {
+        if (*at != '%') {
+            buffer[length++] = *at++;
+            continue;
+        }
+        if (at[1] == '%') {
+            buffer[length++] = '%';
+            at += 2;
+            continue;
+        }
+
+        // Flags, width and precision are kept, the length is replaced.
+        char spec[32];
+        int spec_length = 0;
+        spec[spec_length++] = *at++;
+        while (*at && strchr("-+ #0123456789.", *at) && spec_length < (int)sizeof(spec) - 4) {
+            spec[spec_length++] = *at++;
+        }
+        bool wide = false;
+        while (*at && strchr("hlLqjzt", *at)) {
+            wide |= *at != 'h';
+            at++;
+        }
+        char conversion = *at;
+        if (!conversion) {
+            break;
+        }
+        at++;
+
+        bool has_arg = next_arg < args_count;
+        u64 arg = has_arg ? args[next_arg++] : 0;
+        int available = buffer_size - length;
+        int written = 0;
+
+        if (!has_arg || conversion == 's' || !strchr("diouxXcfFeEgGaAp", conversion)) {
+            written = snprintf(buffer + length, available, "?");
+        } else if (strchr("fFeEgGaA", conversion)) {
+            double value;
+            memcpy(&value, &arg, sizeof(value));
+            spec[spec_length++] = conversion;
+            spec[spec_length] = '\0';
+            written = snprintf(buffer + length, available, spec, value);
+        } else if (conversion == 'p') {
+            written = snprintf(buffer + length, available, "0x%llx", (unsigned long long)arg);
+        } else if (conversion == 'c') {
+            spec[spec_length++] = 'c';
+            spec[spec_length] = '\0';
+            written = snprintf(buffer + length, available, spec, (int)arg);
+        } else {
+            spec[spec_length++] = 'l';
+            spec[spec_length++] = 'l';
+            spec[spec_length++] = conversion;
+            spec[spec_length] = '\0';
+            if (conversion == 'd' || conversion == 'i') {
+                long long value = wide ? (long long)arg : (long long)(s32)arg;
+                written = snprintf(buffer + length, available, spec, value);
+            } else {
+                unsigned long long value = wide ? (unsigned long long)arg : (unsigned long long)(u32)arg;
+                written = snprintf(buffer + length, available, spec, value);
+            }
+        }
+
+        if (written < 0) {
+            break;
+        }
+        length += written;
+        if (length > buffer_size - 1) {
+            length = buffer_size - 1;
+        }
+    }
+
+    buffer[length] = '\0';
+    return length;
+}
@@ -0,0 +1,150 @@
+#ifndef SNAKE_LOGGER_H
+#define SNAKE_LOGGER_H
+
+// Asynchronous binary logger.
+//
+// 'LOG_INFO("Board is now %dx%d", w, h)' costs a clock read and a 64-byte
+// copy into the calling thread's own ring, nothing is formatted or written
+// there. A background thread drains every ring, appends the records to a
+// binary log file and prints the ones at or above the console level. When a
+// ring is full the record is dropped and counted, logging never waits.
+//
+// Formats must be string literals, they're kept by address and written to
+// the file once each. Arguments are numbers only (no '%s'), at most
+// LOG_ARGS_MAX of them. 'snake_log_decode' turns a log file back into text.
+//
+// Levels below LOG_COMPILED_LEVEL compile to nothing, arguments included.
+
+// memcpy()
+#include <string.h>
+
+#define YPL_TYPES_BY_TYPEDEF
+#define YPL_TYPES_USING_EXACT
+#include "ypl_types.h"
+
+//
+// --- Constants ---
+//
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_NONE 4
+
+#ifndef LOG_COMPILED_LEVEL
+#ifdef NDEBUG
+#define LOG_COMPILED_LEVEL LOG_LEVEL_INFO
+#else
+#define LOG_COMPILED_LEVEL LOG_LEVEL_DEBUG
+#endif
+#endif
+
+const u32 LOG_ARGS_MAX = 5;
+const u32 LOG_RING_CAPACITY = 4096; // Records per thread, power of two.
+const int LOG_THREADS_MAX = 64;     // Threads that ever logged, later ones are dropped.
+
+// Log file starts with a Log_File_Header, then entries. Each entry is one
+// Log_File_Record, a LOG_ENTRY_FORMAT one is followed by 'args[0]' bytes of
+// format text (no terminator) and comes before the first record using it.
+const u64 LOG_FILE_MAGIC = 0x474F4C454B414E53ull; // "SNAKELOG"
+const u32 LOG_FILE_VERSION = 1;
+const u32 LOG_ENTRY_RECORD = 0;
+const u32 LOG_ENTRY_FORMAT = 1;
+
+//
+// --- Structs ---
+//
+struct Log_Record;
+struct Log_File_Header;
+struct Log_File_Record;
+
+// What a logging thread puts in its ring. Arguments are packed into u64s,
+// floating point ones as their bits, the format says which is which.
+struct Log_Record {
+    u64 time_ns; // Since 'log_start()'.
+    const char *format;
+    u8 level;
+    u8 args_count;
+    u64 args[LOG_ARGS_MAX];
+};
+
+struct Log_File_Header {
+    u64 magic;
+    u32 version;
+    u32 record_size; // sizeof(Log_File_Record).
+    u64 start_unix_time;
+};
+
+struct Log_File_Record {
+    u32 entry;     // LOG_ENTRY_.
+    u32 format_id; // Index of the format in the order they were written.
+    u64 time_ns;
+    u8 level;
+    u8 args_count;
+    u16 thread;    // Order the thread first logged in.
+    u32 reserved;
+    u64 args[LOG_ARGS_MAX];
+};
+
+//
+// --- Functions ---
+//
+bool log_start(const char *file_path, u32 console_level);
+void log_stop();
+void log_push(Log_Record *record);
+u64 log_get_time_ns();
+u64 log_get_dropped();
+const char *log_get_level_name(u32 level);
+int log_format_record(char *buffer, int buffer_size, const char *format, const u64 *args, u32 args_count);
+
+inline u64 log_pack_arg(int value)                { return (u64)(s64)value; }
+inline u64 log_pack_arg(unsigned int value)       { return (u64)value; }
+inline u64 log_pack_arg(long value)               { return (u64)(s64)value; }
+inline u64 log_pack_arg(unsigned long value)      { return (u64)value; }
+inline u64 log_pack_arg(long long value)          { return (u64)value; }
+inline u64 log_pack_arg(unsigned long long value) { return (u64)value; }
+inline u64 log_pack_arg(char value)               { return (u64)(s64)value; }
+inline u64 log_pack_arg(bool value)               { return (u64)value; }
+inline u64 log_pack_arg(double value)             { u64 bits; memcpy(&bits, &value, sizeof(bits)); return bits; }
+inline u64 log_pack_arg(float value)              { return log_pack_arg((double)value); }
+u64 log_pack_arg(const char *value) = delete; // Strings aren't copied, the pointer wouldn't mean anything later.
+
+template <typename... Args>
+void log_write(u32 level, const char *format, Args... args) {
+    static_assert(sizeof...(Args) <= LOG_ARGS_MAX, "Too many log arguments");
+
+    Log_Record record;
+    record.time_ns = log_get_time_ns();
+    record.format = format;
+    record.level = (u8)level;
+    record.args_count = (u8)sizeof...(Args);
+    u64 packed[] = { log_pack_arg(args)..., 0 };
+    memcpy(record.args, packed, sizeof...(Args) * sizeof(u64));
+    log_push(&record);
+}
+
+#if LOG_COMPILED_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) log_write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if LOG_COMPILED_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) log_write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if LOG_COMPILED_LEVEL <= LOG_LEVEL_WARNING
+#define LOG_WARNING(...) log_write(LOG_LEVEL_WARNING, __VA_ARGS__)
+#else
+#define LOG_WARNING(...) ((void)0)
+#endif
+
+#if LOG_COMPILED_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) log_write(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+#endif /*SNAKE_LOGGER_H*/
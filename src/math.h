@@ -206,21 +206,15 @@ inline bool vec4f_equal(Vec4f a, Vec4f b) {
 }
 
 inline bool vec2i_equal(Vec2i a, Vec2i b) {
-    return (fabs(a.x - b.x) < COMPARE_FLOAT_PRECISION) 
-	&& (fabs(a.y - b.y) < COMPARE_FLOAT_PRECISION);
+    return (a.x == b.x) && (a.y == b.y);
 }
 
 inline bool vec3i_equal(Vec3i a, Vec3i b) {
-    return (fabs(a.x - b.x) < COMPARE_FLOAT_PRECISION) 
-	&& (fabs(a.y - b.y) < COMPARE_FLOAT_PRECISION)
-	&& (fabs(a.z - b.z) < COMPARE_FLOAT_PRECISION);
+    return (a.x == b.x) && (a.y == b.y) && (a.z == b.z);
 }
 
 inline bool vec4i_equal(Vec4i a, Vec4i b) {
-    return (fabs(a.x - b.x) < COMPARE_FLOAT_PRECISION) 
-	&& (fabs(a.y - b.y) < COMPARE_FLOAT_PRECISION)
-	&& (fabs(a.z - b.z) < COMPARE_FLOAT_PRECISION)
-	&& (fabs(a.w - b.w) < COMPARE_FLOAT_PRECISION);
+    return (a.x == b.x) && (a.y == b.y) && (a.z == b.z) && (a.w == b.w);
 }
 
 inline Vec3f vec3f_from_vec4f(Vec4f vec4f) {
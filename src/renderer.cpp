@@ -10,6 +10,7 @@ extern Renderer_Info renderer_info;
 extern GLFWwindow *window;
 
 // Globals from snake.cpp
+extern Game_Snapshot *game_snapshot;
 Player player;
 Resource resource;
 bool imgui_states[];
@@ -542,9 +543,9 @@ void process_button_click(Rectangle *buttons) {
                 if (it == 0) /*New Game*/ {
                     game_state ^= TITLE_SCREEN;
                     game_state |= PLAY;
-                    printf("[%.2f] - New game started.\n", frametime.current);
+                    LOG_INFO("New game started.");
                     print_game_state(game_state);
-                    game_reset();
+                    request_game_reset();
                 } else if (it == 1) /*Settings*/ {
                     game_state |= SETTINGS_SCREEN;
                     print_game_state(game_state);
@@ -635,25 +636,29 @@ void single_press_key_callback(GLFWwindow* window, int key, int scancode, int ac
     if (action == GLFW_PRESS) {
         if (game_state == PLAY) {
             if (key == GLFW_KEY_W) {
-                move_player(&player, 0, 1);
+                move_player(SIM_INPUT_UP);
             }
 
             if (key == GLFW_KEY_S) {
-                move_player(&player, 0, -1);
+                move_player(SIM_INPUT_DOWN);
             }
 
             if (key == GLFW_KEY_A) {
-                move_player(&player, -1, 0);
+                move_player(SIM_INPUT_LEFT);
             }
 
             if (key == GLFW_KEY_D) {
-                move_player(&player, 1, 0);
+                move_player(SIM_INPUT_RIGHT);
             }
         }
 
 	if (key == GLFW_KEY_GRAVE_ACCENT) {
 	    imgui_states[DRAW_EDIT_WINDOW] = !imgui_states[DRAW_EDIT_WINDOW];
-	    printf("[%.2f] - 'Edit' window mode: %s\n", frametime.current, (imgui_states[DRAW_EDIT_WINDOW]) ? "SHOW" : "HIDE");
+	    if (imgui_states[DRAW_EDIT_WINDOW]) {
+	        LOG_INFO("'Edit' window mode: SHOW");
+	    } else {
+	        LOG_INFO("'Edit' window mode: HIDE");
+	    }
 	}
 
 	if ((key == GLFW_KEY_ENTER) && (mods & GLFW_MOD_ALT)) {
@@ -897,29 +902,55 @@ Rectangle draw_text(Font *font, const char *text, float x, float y, float scale,
     return rect;
 }
 
-void draw_square_tiles() {
-    ZoneScoped;
-    
+static void begin_square_tiles() {
     glUseProgram(lighting_shader);
     glBindVertexArray(square_vao);
 
-    glUniformMatrix4fv(square_projection_location, 1, false, &projection[0][0]);
+    // Zoom out when the board doesn't fit on screen.
+    float zoom = get_board_zoom();
+    glm::mat4 board_projection = glm::scale(projection, glm::vec3(1.0f / zoom, 1.0f / zoom, 1.0f));
+    glUniformMatrix4fv(square_projection_location, 1, false, &board_projection[0][0]);
+}
 
-    // Draw Resource.
-    glUniformMatrix4fv(square_model_location, 1, false, &resource.model[0][0]);
-    glUniform3fv(square_color_location, 1, &resource.color[0]);
+static void draw_square_tile(Vec2i tile, glm::vec3 color) {
+    glm::mat4 model = get_tile_model(tile);
+    glUniformMatrix4fv(square_model_location, 1, false, &model[0][0]);
+    glUniform3fv(square_color_location, 1, &color[0]);
     glDrawArrays(GL_TRIANGLES, 0, 6);
+}
+
+// Models are made from the latest snapshot's tiles right here, nothing
+// per tail is kept between frames.
+void draw_square_tiles() {
+    ZoneScoped;
+    
+    Game_Snapshot *snapshot = game_snapshot;
+    begin_square_tiles();
+
+    // Draw Resource.
+    if (snapshot->resource != SIM_NO_RESOURCE) {
+        draw_square_tile(get_snapshot_tile(snapshot, snapshot->resource), resource.color);
+    }
 
     // Draw Player.
-    glUniformMatrix4fv(square_model_location, 1, false, &player.model[0][0]);
-    glUniform3fv(square_color_location, 1, &player.color[0]);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    draw_square_tile(get_snapshot_tile(snapshot, snapshot->tiles[0]), player.color);
 
     // Draw Player's tails.
-    For (player.tail_length) {
-	glUniformMatrix4fv(square_model_location, 1, false, &player.tails[it].model[0][0]);
-	glUniform3fv(square_color_location, 1, &player.tails[it].color[0]);
-	glDrawArrays(GL_TRIANGLES, 0, 6);
+    ForFrom (snapshot->length, 1) {
+        draw_square_tile(get_snapshot_tile(snapshot, snapshot->tiles[it]), player.tails[it - 1].color);
+    }
+}
+
+// @Hack @Debug
+// Fills every tile of the board with tails, to see their colors at once.
+void draw_all_tails_on_screen() {
+    ZoneScoped;
+
+    Game_Snapshot *snapshot = game_snapshot;
+    begin_square_tiles();
+    u32 tiles_count = (u32)snapshot->width * (u32)snapshot->height;
+    for (u32 it = 0; it < tiles_count; it++) {
+        draw_square_tile(get_snapshot_tile(snapshot, it), player.tails[it].color);
     }
 }
 
@@ -1097,7 +1128,7 @@ void renderer_draw(u32 game_state) {
         roboto = load_font_from_file("resources/fonts/Roboto-Regular.ttf", 0, screen.height/24);
         screen.resized = false;
  
-       printf("[%.2f] - New window size: %dx%d\n", frametime.current, screen.width, screen.height);
+       LOG_INFO("New window size: %dx%d", screen.width, screen.height);
         float w = (float)screen.width;
         float h = (float)screen.height;
         text_projection = glm::ortho(0.0f, w, 0.0f, h);
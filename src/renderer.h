@@ -198,6 +198,7 @@ void draw_title_screen();
 void draw_pause_screen();
 void draw_settings_screen();
 void draw_square_tiles();
+void draw_all_tails_on_screen();
 Rectangle draw_text(Font *font, Screen_Text text, float scale = 1.0f);
 Rectangle draw_text(Font *font, const char *text, float x, float y, float scale, Vec3f color, u16 flags = TEXT_ALIGN_ORIGIN);
 Rectangle draw_text2(Font *font, const char *text, float x, float y, float scale, Vec3f color, u16 flags = TEXT_ALIGN_ORIGIN);
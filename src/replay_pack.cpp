@@ -0,0 +1,281 @@
+// Compresses replays with zstd and trains the dictionaries for it.
+//
+// Usage:
+//   snake_replay_pack train <dictionary out> <replay file>...
+//     Cuts the replays into games and trains a dictionary on them, one
+//     sample per game, as single-game replays are what it's for.
+//   snake_replay_pack split <replay file> <out prefix>
+//     Writes every game as a replay of its own, '<prefix>_<n>.replay'.
+//   snake_replay_pack compress [-d <dictionary>] [-l <level>] <in> <out>
+//   snake_replay_pack decompress [-d <dictionary>] <in> <out>
+// Input replays may already be compressed, without a dictionary.
+
+// printf(), fopen(), fread(), fwrite()
+#include <stdio.h>
+// malloc(), realloc(), free(), atoi()
+#include <stdlib.h>
+// memcpy(), strcmp()
+#include <string.h>
+
+#include "sim_replay.h"
+
+//
+// --- Helpers ---
+//
+static u8 *read_whole_file(const char *path, u64 *size) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    u8 *data = (length >= 0) ? (u8 *) malloc((size_t)length + 1) : NULL;
+    if (data && fread(data, 1, (size_t)length, file) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    *size = (u64)length;
+    return data;
+}
+
+static bool write_whole_file(const char *path, const void *data, u64 size) {
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    bool written = fwrite(data, 1, (size_t)size, file) == size;
+    return (fclose(file) == 0) && written;
+}
+
+// Reads a replay uncompressed. Prints why when it can't.
+static u8 *read_replay(const char *path, Sim_Decompressor *decompressor, u64 *size) {
+    u8 *data = read_whole_file(path, size);
+    if (!data) {
+        printf("%s: couldn't read the file.\n", path);
+        return NULL;
+    }
+    if (sim_is_compressed(data, *size)) {
+        u8 *compressed = data;
+        data = sim_decompress_all(decompressor, compressed, *size, size);
+        free(compressed);
+        if (!data) {
+            printf("%s: couldn't decompress, it's damaged or needs another dictionary.\n", path);
+        }
+    }
+    return data;
+}
+
+// Takes '-d <dictionary>' and '-l <level>' from the front of the arguments.
+// Returns the index of the first one after them.
+static int read_options(int arguments_count, char **arguments, int first, const char **dictionary_path, int *level) {
+    while (first + 1 < arguments_count) {
+        if (strcmp(arguments[first], "-d") == 0) {
+            *dictionary_path = arguments[first + 1];
+        } else if (strcmp(arguments[first], "-l") == 0 && level) {
+            *level = atoi(arguments[first + 1]);
+        } else {
+            break;
+        }
+        first += 2;
+    }
+    return first;
+}
+
+//
+// --- Commands ---
+//
+static int train(const char *dictionary_path, char **paths, int paths_count) {
+    Sim_Decompressor decompressor;
+    if (!sim_init_decompressor(&decompressor, NULL, 0)) {
+        return 1;
+    }
+
+    // Every game gets its own copy of the file header, so samples look like the files they're for.
+    u8 *samples = NULL;
+    u64 samples_size = 0;
+    u64 *sample_sizes = NULL;
+    u32 samples_count = 0;
+    u32 samples_capacity = 0;
+    for (int at = 0; at < paths_count; at++) {
+        u64 size;
+        u8 *data = read_replay(paths[at], &decompressor, &size);
+        Sim_Replay_Reader reader;
+        if (!data || !sim_replay_open_reader(&reader, data, size)) {
+            free(data);
+            continue;
+        }
+
+        u64 begin, end;
+        while (sim_replay_find_game(&reader, &begin, &end)) {
+            u64 sample_size = sizeof(Sim_Replay_File_Header) + end - begin;
+            u8 *grown = (u8 *) realloc(samples, (size_t)(samples_size + sample_size));
+            if (samples_count == samples_capacity) {
+                samples_capacity = samples_capacity ? samples_capacity * 2 : 1024;
+                sample_sizes = (u64 *) realloc(sample_sizes, samples_capacity * sizeof(u64));
+            }
+            if (!grown || !sample_sizes) {
+                printf("Out of memory after %u games.\n", samples_count);
+                return 1;
+            }
+            samples = grown;
+            memcpy(samples + samples_size, data, sizeof(Sim_Replay_File_Header));
+            memcpy(samples + samples_size + sizeof(Sim_Replay_File_Header), data + begin, (size_t)(end - begin));
+            samples_size += sample_size;
+            sample_sizes[samples_count++] = sample_size;
+        }
+        free(data);
+    }
+    sim_free_decompressor(&decompressor);
+
+    u8 dictionary[SIM_DICTIONARY_SIZE_DEFAULT];
+    u64 dictionary_size = samples_count ? sim_train_dictionary(dictionary, sizeof(dictionary), samples, sample_sizes, samples_count) : 0;
+    free(samples);
+    free(sample_sizes);
+    if (dictionary_size == 0) {
+        printf("Couldn't train a dictionary on %u games, it needs more of them.\n", samples_count);
+        return 1;
+    }
+    if (!write_whole_file(dictionary_path, dictionary, dictionary_size)) {
+        printf("Couldn't write '%s'.\n", dictionary_path);
+        return 1;
+    }
+    printf("Trained a %llu-byte dictionary on %u games (%llu bytes).\n", (unsigned long long)dictionary_size, samples_count,
+           (unsigned long long)samples_size);
+    return 0;
+}
+
+static int split(const char *path, const char *prefix) {
+    Sim_Decompressor decompressor;
+    if (!sim_init_decompressor(&decompressor, NULL, 0)) {
+        return 1;
+    }
+    u64 size;
+    u8 *data = read_replay(path, &decompressor, &size);
+    sim_free_decompressor(&decompressor);
+    Sim_Replay_Reader reader;
+    if (!data || !sim_replay_open_reader(&reader, data, size)) {
+        free(data);
+        return 1;
+    }
+
+    u64 begin, end;
+    u32 games = 0;
+    int result = 0;
+    while (sim_replay_find_game(&reader, &begin, &end)) {
+        games++;
+        char game_path[1024];
+        snprintf(game_path, sizeof(game_path), "%s_%u.replay", prefix, games);
+        FILE *file = fopen(game_path, "wb");
+        bool written = file && fwrite(data, sizeof(Sim_Replay_File_Header), 1, file) == 1 &&
+                       fwrite(data + begin, 1, (size_t)(end - begin), file) == end - begin;
+        written = file && (fclose(file) == 0) && written;
+        if (!written) {
+            printf("Couldn't write '%s'.\n", game_path);
+            result = 1;
+            break;
+        }
+    }
+    free(data);
+    printf("Wrote %u games.\n", games);
+    return result;
+}
+
+static int compress(const char *dictionary_path, int level, const char *in_path, const char *out_path) {
+    u64 dictionary_size = 0;
+    u8 *dictionary = dictionary_path ? read_whole_file(dictionary_path, &dictionary_size) : NULL;
+    if (dictionary_path && !dictionary) {
+        printf("Couldn't read the dictionary '%s'.\n", dictionary_path);
+        return 1;
+    }
+    Sim_Compressor compressor;
+    Sim_Decompressor decompressor;
+    bool made = sim_init_compressor(&compressor, level, dictionary, dictionary_size);
+    made = sim_init_decompressor(&decompressor, NULL, 0) && made;
+    free(dictionary);
+    if (!made) {
+        printf("Couldn't set up compression, '%s' may not be a dictionary.\n", dictionary_path ? dictionary_path : "");
+        return 1;
+    }
+
+    u64 size = 0;
+    u8 *data = read_replay(in_path, &decompressor, &size);
+    u64 capacity = sim_get_compressed_size_max(size);
+    u8 *compressed = data ? (u8 *) malloc((size_t)capacity) : NULL;
+    u64 compressed_size = compressed ? sim_compress(&compressor, compressed, capacity, data, size) : 0;
+    int result = 1;
+    if (compressed_size > 0 && write_whole_file(out_path, compressed, compressed_size)) {
+        printf("%llu bytes to %llu.\n", (unsigned long long)size, (unsigned long long)compressed_size);
+        result = 0;
+    } else if (data) {
+        printf("Couldn't compress to '%s'.\n", out_path);
+    }
+    free(compressed);
+    free(data);
+    sim_free_compressor(&compressor);
+    sim_free_decompressor(&decompressor);
+    return result;
+}
+
+static int decompress(const char *dictionary_path, const char *in_path, const char *out_path) {
+    u64 dictionary_size = 0;
+    u8 *dictionary = dictionary_path ? read_whole_file(dictionary_path, &dictionary_size) : NULL;
+    if (dictionary_path && !dictionary) {
+        printf("Couldn't read the dictionary '%s'.\n", dictionary_path);
+        return 1;
+    }
+    Sim_Decompressor decompressor;
+    bool made = sim_init_decompressor(&decompressor, dictionary, dictionary_size);
+    free(dictionary);
+    if (!made) {
+        printf("Couldn't set up decompression, '%s' may not be a dictionary.\n", dictionary_path ? dictionary_path : "");
+        return 1;
+    }
+
+    u64 size;
+    u8 *data = read_replay(in_path, &decompressor, &size);
+    sim_free_decompressor(&decompressor);
+    if (!data) {
+        return 1;
+    }
+    bool written = write_whole_file(out_path, data, size);
+    free(data);
+    if (!written) {
+        printf("Couldn't write '%s'.\n", out_path);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int arguments_count, char **arguments) {
+    const char *command = (arguments_count > 1) ? arguments[1] : "";
+    const char *dictionary_path = NULL;
+    int level = SIM_COMPRESSION_LEVEL_DEFAULT;
+
+    if (strcmp(command, "train") == 0 && arguments_count >= 4) {
+        return train(arguments[2], arguments + 3, arguments_count - 3);
+    }
+    if (strcmp(command, "split") == 0 && arguments_count == 4) {
+        return split(arguments[2], arguments[3]);
+    }
+    if (strcmp(command, "compress") == 0) {
+        int first = read_options(arguments_count, arguments, 2, &dictionary_path, &level);
+        if (arguments_count - first == 2) {
+            return compress(dictionary_path, level, arguments[first], arguments[first + 1]);
+        }
+    }
+    if (strcmp(command, "decompress") == 0) {
+        int first = read_options(arguments_count, arguments, 2, &dictionary_path, NULL);
+        if (arguments_count - first == 2) {
+            return decompress(dictionary_path, arguments[first], arguments[first + 1]);
+        }
+    }
+
+    printf("Usage:\n");
+    printf("  snake_replay_pack train <dictionary out> <replay file>...\n");
+    printf("  snake_replay_pack split <replay file> <out prefix>\n");
+    printf("  snake_replay_pack compress [-d <dictionary>] [-l <level>] <in> <out>\n");
+    printf("  snake_replay_pack decompress [-d <dictionary>] <in> <out>\n");
+    return 1;
+}
@@ -0,0 +1,349 @@
+// Plays replays written by 'sim_replay_open()' again, headless and as fast as
+// the simulation goes, and checks every game ends up where it was recorded.
+//
+// Usage: snake_replay_verify [-v] [-d <dictionary>] [-s <game> <tick>] <replay file>...
+// A game passes when its tick, score, moves and state hash all match what was
+// recorded at its end, its keyframes match the state played up to them, and
+// the rules ended it exactly when the recording says they did. Prints the
+// games that don't pass (every game with '-v') and ticks per second over all
+// of them. Exits with 1 if any game failed. Games recorded after an edit
+// start from the state saved with them, only builds with the same 'Sim_State'
+// can play those.
+// With '-s' it instead goes to tick <tick> of game <game> (from 1) of every
+// replay through the keyframe index, prints the state there, and checks it
+// against playing the game from its start.
+// Compressed replays are decompressed first, with the dictionary they were
+// compressed with if there was one.
+
+// printf(), fopen(), fread()
+#include <stdio.h>
+// malloc(), free(), atoll(), strtoull()
+#include <stdlib.h>
+// strcmp()
+#include <string.h>
+#include <chrono>
+
+#include "sim_replay.h"
+
+//
+// --- Structs ---
+//
+struct Verify_Totals {
+    u64 games;
+    u64 passed;
+    u64 failed;
+    u64 unfinished; // Recording stopped before the game's end entry, nothing to check against.
+    u64 ticks;
+    double seconds;
+    double decompress_seconds;
+};
+
+//
+// --- Helpers ---
+//
+static double get_time_seconds() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static u8 *read_whole_file(const char *path, u64 *size) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    u8 *data = (length >= 0) ? (u8 *) malloc((size_t)length + 1) : NULL;
+    if (data && fread(data, 1, (size_t)length, file) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    *size = (u64)length;
+    return data;
+}
+
+// Makes a state for the board in 'arena', growing it when it's too small.
+static Sim_State *init_board(Memory_Arena *arena, int width, int height) {
+    u64 needed = sim_get_memory_size(width, height);
+    if (arena->capacity < needed) {
+        free_memory_arena(arena);
+        *arena = alloc_memory_arena(needed);
+        if (!arena->data) {
+            return NULL;
+        }
+    }
+    clear_memory_arena(arena);
+    return sim_init(arena, width, height);
+}
+
+// Reads a replay uncompressed. Prints why when it can't.
+static u8 *read_replay(const char *path, Sim_Decompressor *decompressor, u64 *size, Verify_Totals *totals) {
+    u8 *data = read_whole_file(path, size);
+    if (!data) {
+        printf("%s: couldn't read the file.\n", path);
+        return NULL;
+    }
+    if (sim_is_compressed(data, *size)) {
+        double start = get_time_seconds();
+        u8 *compressed = data;
+        data = sim_decompress_all(decompressor, compressed, *size, size);
+        totals->decompress_seconds += get_time_seconds() - start;
+        free(compressed);
+        if (!data) {
+            printf("%s: couldn't decompress, it's damaged or needs another dictionary.\n", path);
+        }
+    }
+    return data;
+}
+
+// Why the played game doesn't match its recorded end, NULL when it does.
+static const char *check_game_end(Sim_State *state, Sim_Replay_Entry *end, Sim_Replay_Playback *playback) {
+    bool over = (playback->events & (SIM_EVENT_DIED | SIM_EVENT_WON)) != 0;
+    if (playback->ignored > 0) {
+        return "rules ended the game before its inputs did";
+    }
+    if (playback->keyframes_differ > 0) {
+        return "a keyframe differs from the played state";
+    }
+    if (state->tick != end->tick) {
+        return "tick differs";
+    }
+    if (state->score != end->score || state->moves != end->moves) {
+        return "score or moves differ";
+    }
+    if (state->hash != end->hash) {
+        return "state hash differs";
+    }
+    if (end->end_reason == SIM_REPLAY_END_DIED && !(over && (playback->events & SIM_EVENT_DIED))) {
+        return "recorded as died, player is alive";
+    }
+    if (end->end_reason == SIM_REPLAY_END_WON && !(over && (playback->events & SIM_EVENT_WON))) {
+        return "recorded as won, game isn't won";
+    }
+    if ((end->end_reason == SIM_REPLAY_END_ABANDONED || end->end_reason == SIM_REPLAY_END_EDITED) && over) {
+        return "rules ended a game recorded as still going";
+    }
+    return NULL;
+}
+
+// Plays every game of one replay. Returns false if the file couldn't be read
+// all the way, games before the bad part are still counted.
+static bool verify_replay(const char *path, Memory_Arena *arena, Sim_Decompressor *decompressor, bool verbose, Verify_Totals *totals) {
+    u64 size;
+    u8 *data = read_replay(path, decompressor, &size, totals);
+    if (!data) {
+        return false;
+    }
+    Sim_Replay_Reader reader;
+    if (!sim_replay_open_reader(&reader, data, size)) {
+        printf("%s: not a replay, or one of another version.\n", path);
+        free(data);
+        return false;
+    }
+
+    Sim_Replay_Entry entry;
+    Sim_Replay_Playback playback;
+    u32 kind = sim_replay_read(&reader, &entry);
+    u64 game = 0;
+    while (kind == SIM_REPLAY_ENTRY_GAME_START) {
+        game++;
+        totals->games++;
+        u64 seed = entry.seed;
+        int width = entry.width;
+        int height = entry.height;
+        Sim_State *state = init_board(arena, width, height);
+        if (!state) {
+            printf("%s: game %llu, couldn't make a %dx%d board.\n", path, (unsigned long long)game, width, height);
+            free(data);
+            return false;
+        }
+        if (!sim_replay_start_game(&reader, &entry, state)) {
+            // Edited game whose state is another build's, or damaged. Its inputs are skipped.
+            totals->failed++;
+            printf("%s: game %llu, %dx%d, starts from a state this build can't use.\n", path, (unsigned long long)game, width, height);
+            do {
+                kind = sim_replay_read(&reader, &entry);
+            } while (kind == SIM_REPLAY_ENTRY_RUN || kind == SIM_REPLAY_ENTRY_GROUP || kind == SIM_REPLAY_ENTRY_KEYFRAME);
+            if (kind == SIM_REPLAY_ENTRY_GAME_END) {
+                kind = sim_replay_read(&reader, &entry);
+            }
+            continue;
+        }
+
+        double start = get_time_seconds();
+        kind = sim_replay_play_inputs(&reader, state, &entry, &playback);
+        totals->seconds += get_time_seconds() - start;
+        totals->ticks += playback.ticks;
+
+        if (kind != SIM_REPLAY_ENTRY_GAME_END) {
+            totals->unfinished++;
+            if (verbose) {
+                printf("%s: game %llu, %dx%d, %llu ticks, no recorded end.\n", path, (unsigned long long)game, width, height,
+                       (unsigned long long)playback.ticks);
+            }
+            continue;
+        }
+
+        const char *failure = check_game_end(state, &entry, &playback);
+        if (failure) {
+            totals->failed++;
+        } else {
+            totals->passed++;
+        }
+        if (failure || verbose) {
+            printf("%s: game %llu, seed %llu, %dx%d, %s at tick %llu, score %d: %s\n", path, (unsigned long long)game,
+                   (unsigned long long)seed, width, height, sim_get_replay_end_reason_name(entry.end_reason),
+                   (unsigned long long)entry.tick, entry.score, failure ? failure : "OK");
+        }
+        if (failure) {
+            printf("    recorded: tick %llu, score %d, moves %d, hash %016llx\n", (unsigned long long)entry.tick, entry.score,
+                   entry.moves, (unsigned long long)entry.hash);
+            printf("    played:   tick %llu, score %d, moves %d, hash %016llx, %llu inputs left over\n", (unsigned long long)state->tick,
+                   state->score, state->moves, (unsigned long long)state->hash, (unsigned long long)playback.ignored);
+        }
+        kind = sim_replay_read(&reader, &entry);
+    }
+
+    free(data);
+    if (kind != SIM_REPLAY_ENTRY_END) {
+        printf("%s: replay is cut short or malformed after game %llu.\n", path, (unsigned long long)game);
+        return false;
+    }
+    return true;
+}
+
+// Goes to a tick of one game both through the keyframes and from the game's
+// start, and checks they agree. Returns false if they don't or it couldn't.
+static bool seek_replay(const char *path, Memory_Arena *arena, Sim_Decompressor *decompressor, u32 game, u64 tick, Verify_Totals *totals) {
+    u64 size;
+    u8 *data = read_replay(path, decompressor, &size, totals);
+    if (!data) {
+        return false;
+    }
+    Sim_Replay_Reader reader;
+    Sim_Replay_Index index;
+    if (!sim_replay_open_reader(&reader, data, size) || !sim_replay_load_index(&index, &reader)) {
+        printf("%s: not a replay, or one of another version.\n", path);
+        free(data);
+        return false;
+    }
+
+    Sim_Replay_Entry start;
+    Sim_Replay_Index_Game indexed;
+    Sim_State *state = NULL;
+    if (sim_replay_get_game_start(&reader, &index, game - 1, &start)) {
+        sim_replay_get_index_game(&index, game - 1, &indexed);
+        state = init_board(arena, start.width, start.height);
+    }
+    if (!state) {
+        printf("%s: has no game %u, it has %u.\n", path, game, index.games_count);
+        sim_replay_free_index(&index);
+        free(data);
+        return false;
+    }
+
+    // The same state is used for both, so only what's compared is kept of the first.
+    Sim_Replay_Cursor cursor;
+    double seconds[2];
+    u64 ticks[2], hashes[2];
+    int scores[2], moves[2];
+    bool sought = true;
+    For (2) {
+        double begin = get_time_seconds();
+        sought = sim_replay_seek(&cursor, &reader, &index, game - 1, tick, state, it == 0) && sought;
+        seconds[it] = get_time_seconds() - begin;
+        ticks[it] = cursor.tick;
+        hashes[it] = state->hash;
+        scores[it] = state->score;
+        moves[it] = state->moves;
+    }
+    bool same = sought && ticks[0] == ticks[1] && hashes[0] == hashes[1] && scores[0] == scores[1] && moves[0] == moves[1];
+
+    printf("%s: game %u, %dx%d, %llu ticks recorded, %u keyframes %llu ticks apart.\n", path, game, start.width, start.height,
+           (unsigned long long)indexed.ticks, indexed.keyframes_count, (unsigned long long)indexed.keyframe_interval);
+    if (!sought) {
+        printf("    index doesn't match the replay, or the game starts from a state this build can't use.\n");
+    } else {
+        Vec2i head = state->player.head;
+        printf("    at tick %llu: score %d, moves %d, length %d, head at [%d, %d], hash %016llx\n", (unsigned long long)ticks[1],
+               scores[1], moves[1], state->player.tail_length + 1, head.x, head.y, (unsigned long long)hashes[1]);
+        printf("    %.3f ms through keyframes, %.3f ms from the start: %s\n", seconds[0] * 1e3, seconds[1] * 1e3,
+               same ? "same state" : "states differ");
+    }
+    sim_replay_free_index(&index);
+    free(data);
+    return same;
+}
+
+int main(int arguments_count, char **arguments) {
+    bool verbose = false;
+    const char *dictionary_path = NULL;
+    bool seeking = false;
+    long long seek_game = 0;
+    unsigned long long seek_tick = 0;
+    int first_path = 1;
+    while (first_path < arguments_count) {
+        if (strcmp(arguments[first_path], "-v") == 0) {
+            verbose = true;
+            first_path++;
+        } else if (strcmp(arguments[first_path], "-d") == 0 && first_path + 1 < arguments_count) {
+            dictionary_path = arguments[first_path + 1];
+            first_path += 2;
+        } else if (strcmp(arguments[first_path], "-s") == 0 && first_path + 2 < arguments_count) {
+            seeking = true;
+            seek_game = atoll(arguments[first_path + 1]);
+            seek_tick = strtoull(arguments[first_path + 2], NULL, 10);
+            first_path += 3;
+        } else {
+            break;
+        }
+    }
+    if (first_path >= arguments_count || (seeking && (seek_game < 1 || seek_game > U32_MAX))) {
+        printf("Usage: snake_replay_verify [-v] [-d <dictionary>] [-s <game> <tick>] <replay file>...\n");
+        return 1;
+    }
+
+    u64 dictionary_size = 0;
+    u8 *dictionary = NULL;
+    if (dictionary_path) {
+        dictionary = read_whole_file(dictionary_path, &dictionary_size);
+        if (!dictionary) {
+            printf("Couldn't read the dictionary '%s'.\n", dictionary_path);
+            return 1;
+        }
+    }
+    Sim_Decompressor decompressor;
+    if (!sim_init_decompressor(&decompressor, dictionary, dictionary_size)) {
+        printf("Couldn't set up decompression, '%s' may not be a dictionary.\n", dictionary_path ? dictionary_path : "");
+        free(dictionary);
+        return 1;
+    }
+
+    Memory_Arena arena = {};
+    Verify_Totals totals = {};
+    bool all_read = true;
+    for (int at = first_path; at < arguments_count; at++) {
+        if (seeking) {
+            all_read = seek_replay(arguments[at], &arena, &decompressor, (u32)seek_game, seek_tick, &totals) && all_read;
+        } else {
+            all_read = verify_replay(arguments[at], &arena, &decompressor, verbose, &totals) && all_read;
+        }
+    }
+    free_memory_arena(&arena);
+    sim_free_decompressor(&decompressor);
+    free(dictionary);
+    if (seeking) {
+        return all_read ? 0 : 1;
+    }
+
+    double ticks_per_second = (totals.seconds > 0.0) ? totals.ticks / totals.seconds : 0.0;
+    printf("%llu games: %llu passed, %llu failed, %llu without an end.\n", (unsigned long long)totals.games,
+           (unsigned long long)totals.passed, (unsigned long long)totals.failed, (unsigned long long)totals.unfinished);
+    printf("%llu ticks in %.3f s, %.1f million ticks/s.\n", (unsigned long long)totals.ticks, totals.seconds, ticks_per_second / 1e6);
+    if (totals.decompress_seconds > 0.0) {
+        printf("%.3f s decompressing.\n", totals.decompress_seconds);
+    }
+    return (totals.failed == 0 && all_read) ? 0 : 1;
+}
@@ -0,0 +1,435 @@
+// assert()
+#include <assert.h>
+// malloc(), free()
+#include <stdlib.h>
+// memset()
+#include <string.h>
+
+#include "sim.h"
+
+// 'data' is NULL and 'capacity' is 0 if malloc fails.
+Memory_Arena alloc_memory_arena(u64 capacity) {
+    Memory_Arena mem;
+    mem.data = (u8 *) malloc(capacity * sizeof(u8));
+    mem.capacity = mem.data ? capacity : 0;
+    mem.size = 0;
+    return mem;
+}
+
+void free_memory_arena(Memory_Arena *arena) {
+    free(arena->data);
+    arena->data = NULL;
+    arena->capacity = 0;
+    arena->size = 0;
+}
+
+void clear_memory_arena(Memory_Arena *arena) {
+    arena->size = 0;
+}
+
+// Returns NULL when the arena is out of space. Allocations are 64-byte
+// aligned in memory (not just within the arena, malloc only promises 16),
+// so separate arrays never share a cache line.
+void *push_memory_arena(Memory_Arena *arena, u64 size) {
+    u64 address = (u64)(arena->data + arena->size);
+    u64 offset = arena->size + (((address + 63) & ~63ull) - address);
+    if (offset + size > arena->capacity) {
+        return NULL;
+    }
+    arena->size = offset + size;
+    return arena->data + offset;
+}
+
+//
+// --- Step kernels ---
+//
+
+// Board shapes for 'step_kernel()'. The generic one reads the size from the
+// state, the others know all of it (or the width) at compile time, so tile
+// index math becomes constant multiplies or shifts and masks.
+struct Board_Generic {
+    static bool in_bounds(Sim_State *state, Vec2i tile) { return sim_tile_in_bounds(state, tile); }
+    static u32 index(Sim_State *state, Vec2i tile) { return sim_tile_index(state, tile); }
+    static u32 body_mask(Sim_State *state) { return state->player.body_mask; }
+};
+
+template <int Width, int Height>
+struct Board_Fixed {
+    static bool in_bounds(Sim_State *, Vec2i tile) { return ((u32)tile.x < (u32)Width) && ((u32)tile.y < (u32)Height); }
+    static u32 index(Sim_State *, Vec2i tile) { return (u32)tile.y * (u32)Width + (u32)tile.x; }
+    static u32 body_mask(Sim_State *) { return sim_get_body_capacity(Width * Height) - 1; }
+};
+
+template <int Width_Shift>
+struct Board_Pow2_Width {
+    static bool in_bounds(Sim_State *state, Vec2i tile) { return ((u32)tile.x < (1u << Width_Shift)) && ((u32)tile.y < (u32)state->height); }
+    static u32 index(Sim_State *, Vec2i tile) { return ((u32)tile.y << Width_Shift) | (u32)tile.x; }
+    static u32 body_mask(Sim_State *state) { return state->player.body_mask; }
+};
+
+template <typename Board>
+static u32 step_kernel(Sim_State *state, Sim_Input input) {
+    Vec2i direction = sim_input_direction(input);
+    if (direction.x == 0 && direction.y == 0) {
+        return SIM_EVENT_NONE;
+    }
+
+    Sim_Player *player = &state->player;
+    u32 body_mask = Board::body_mask(state);
+    u32 events = SIM_EVENT_MOVED;
+
+    // The tile the player's last part leaves if nothing is eaten.
+    // With no tails it's the head itself.
+    u32 *body = sim_get_body(state);
+    u32 last = body[(player->body_head - player->tail_length) & body_mask];
+
+    Vec2i head = player->head;
+    head.x += direction.x;
+    head.y += direction.y;
+    player->head = head;
+    state->moves++;
+    state->tick++;
+
+    if (!Board::in_bounds(state, head)) {
+        events |= SIM_EVENT_DIED;
+        return events;
+    }
+
+    // Tails didn't move yet, so the last tail still blocks its tile.
+    u32 index = Board::index(state, head);
+    if (sim_tile_occupied(state, index)) {
+        events |= SIM_EVENT_DIED;
+        return events;
+    }
+    sim_occupy_tile(state, index);
+    state->hash ^= sim_get_zobrist_key(SIM_ZOBRIST_HEAD, body[player->body_head]) ^
+                   sim_get_zobrist_key(SIM_ZOBRIST_HEAD, index);
+    player->body_head = (player->body_head + 1) & body_mask;
+    body[player->body_head] = index;
+
+    if (index == state->resource) {
+        // Occupancy already matches the player after this move,
+        // because the last tail stays where it is and becomes the new one.
+        player->tail_length++;
+        state->score++;
+        events |= SIM_EVENT_RESOURCE_PICKED;
+        if (!sim_move_resource_to_rand_pos(state)) {
+            events |= SIM_EVENT_WON;
+        }
+    } else {
+        sim_free_tile(state, last);
+    }
+
+    return events;
+}
+
+struct Step_Kernel {
+    const char *name;
+    u32 (*step)(Sim_State *state, Sim_Input input);
+};
+
+// Indexed by Sim_Kernel.
+static const Step_Kernel step_kernels[SIM_KERNEL_COUNT] = {
+    { "generic", step_kernel<Board_Generic> },
+    { "15x9", step_kernel<Board_Fixed<15, 9>> },
+    { "16x16", step_kernel<Board_Fixed<16, 16>> },
+    { "32x32", step_kernel<Board_Fixed<32, 32>> },
+    { "2xN", step_kernel<Board_Pow2_Width<1>> },
+    { "4xN", step_kernel<Board_Pow2_Width<2>> },
+    { "8xN", step_kernel<Board_Pow2_Width<3>> },
+    { "16xN", step_kernel<Board_Pow2_Width<4>> },
+    { "32xN", step_kernel<Board_Pow2_Width<5>> },
+    { "64xN", step_kernel<Board_Pow2_Width<6>> },
+    { "128xN", step_kernel<Board_Pow2_Width<7>> },
+    { "256xN", step_kernel<Board_Pow2_Width<8>> },
+    { "512xN", step_kernel<Board_Pow2_Width<9>> },
+    { "1024xN", step_kernel<Board_Pow2_Width<10>> },
+    { "2048xN", step_kernel<Board_Pow2_Width<11>> },
+    { "4096xN", step_kernel<Board_Pow2_Width<12>> },
+};
+
+// Exact shapes win over power-of-two widths, anything else is generic.
+u32 sim_pick_kernel(int width, int height) {
+    if (width == 15 && height == 9)  return SIM_KERNEL_FIXED_15X9;
+    if (width == 16 && height == 16) return SIM_KERNEL_FIXED_16X16;
+    if (width == 32 && height == 32) return SIM_KERNEL_FIXED_32X32;
+
+    if ((width & (width - 1)) == 0) {
+        int shift = 0;
+        while ((1 << shift) < width) {
+            shift++;
+        }
+        return SIM_KERNEL_POW2_WIDTH_FIRST + (shift - 1);
+    }
+    return SIM_KERNEL_GENERIC;
+}
+
+const char *sim_get_kernel_name(u32 kernel) {
+    assert(kernel < SIM_KERNEL_COUNT);
+    return step_kernels[kernel].name;
+}
+
+static u64 align_state_offset(u64 offset) {
+    return (offset + 63) & ~63ull;
+}
+
+// Byte size of the state block for a board, with every array starting
+// on its own cache line. Fills in the offsets when 'state' isn't NULL.
+static u64 layout_state(Sim_State *state, int width, int height) {
+    u64 tiles_count = (u64)width * (u64)height;
+    u64 offset = align_state_offset(sizeof(Sim_State));
+
+    u64 body_offset = offset;
+    offset = align_state_offset(offset + sim_get_body_capacity((u32)tiles_count) * sizeof(u32));
+    u64 occupancy_offset = offset;
+    offset = align_state_offset(offset + ((tiles_count + 63) / 64) * sizeof(u64));
+    u64 free_tiles_offset = offset;
+    offset = align_state_offset(offset + tiles_count * sizeof(u32));
+    u64 free_slot_offset = offset;
+    offset = align_state_offset(offset + tiles_count * sizeof(u32));
+
+    if (state) {
+        state->size = offset;
+        state->body_offset = (u32)body_offset;
+        state->occupancy_offset = (u32)occupancy_offset;
+        state->free_tiles_offset = (u32)free_tiles_offset;
+        state->free_slot_offset = (u32)free_slot_offset;
+    }
+    return offset;
+}
+
+// Bytes of the state block for a board, what 'size' of the state will be.
+u64 sim_get_state_size(int width, int height) {
+    return layout_state(NULL, width, height);
+}
+
+// How much arena space 'sim_init()' needs for a board, alignment included.
+u64 sim_get_memory_size(int width, int height) {
+    return sim_get_state_size(width, height) + 63;
+}
+
+// Takes the state block for a board from 'arena' and sizes it.
+// Returns NULL if the size is out of range or the arena is too small.
+Sim_State *sim_init(Memory_Arena *arena, int width, int height) {
+    ZoneScoped;
+
+    if (width < SIM_BOARD_SIDE_MIN || width > SIM_BOARD_SIDE_MAX ||
+        height < SIM_BOARD_SIDE_MIN || height > SIM_BOARD_SIDE_MAX) {
+        return NULL;
+    }
+
+    Sim_State *state = (Sim_State *) push_memory_arena(arena, layout_state(NULL, width, height));
+    if (!state) {
+        return NULL;
+    }
+
+    memset(state, 0, sizeof(Sim_State));
+    layout_state(state, width, height);
+    state->width = width;
+    state->height = height;
+    state->tiles_count = (u32)width * (u32)height;
+    state->kernel = sim_pick_kernel(width, height);
+    state->player.body_mask = sim_get_body_capacity(state->tiles_count) - 1;
+
+    return state;
+}
+
+// Checkpoint or rollback: 'to' becomes exactly 'from', arrays included.
+// Both must have been made by 'sim_init()' for the same board size.
+// It's one memcpy, so it costs the block size and nothing else.
+void sim_copy_state(Sim_State *to, Sim_State *from) {
+    ZoneScoped;
+
+    assert(to->size == from->size && to->width == from->width && to->height == from->height);
+    memcpy(to, from, from->size);
+}
+
+// Whether 'bytes' bytes at 'state' look like a block 'sim_init()' made: the
+// board size, the array layout, and the player and resource within the board.
+// Array contents aren't looked at. For states that come from outside.
+bool sim_check_state(Sim_State *state, u64 bytes) {
+    if (bytes < sizeof(Sim_State)) {
+        return false;
+    }
+    if (state->width < SIM_BOARD_SIDE_MIN || state->width > SIM_BOARD_SIDE_MAX ||
+        state->height < SIM_BOARD_SIDE_MIN || state->height > SIM_BOARD_SIDE_MAX) {
+        return false;
+    }
+
+    Sim_State layout;
+    layout_state(&layout, state->width, state->height);
+    u32 tiles_count = (u32)state->width * (u32)state->height;
+    Sim_Player *player = &state->player;
+    return state->size == bytes && layout.size == bytes &&
+           state->body_offset == layout.body_offset && state->occupancy_offset == layout.occupancy_offset &&
+           state->free_tiles_offset == layout.free_tiles_offset && state->free_slot_offset == layout.free_slot_offset &&
+           state->tiles_count == tiles_count && state->kernel < SIM_KERNEL_COUNT &&
+           player->body_mask == sim_get_body_capacity(tiles_count) - 1 && player->body_head <= player->body_mask &&
+           player->tail_length >= 0 && (u32)player->tail_length < tiles_count && sim_tile_in_bounds(state, player->head) &&
+           (state->resource < tiles_count || state->resource == SIM_NO_RESOURCE) && state->free_count <= tiles_count;
+}
+
+// Restarts the game on the board 'sim_init()' set up. Costs O(board area).
+void sim_reset(Sim_State *state, u64 seed) {
+    ZoneScoped;
+
+    state->seed = seed;
+    sim_rng_seed(&state->rng, seed, 0);
+    state->score = 0;
+    state->moves = 0;
+    state->tick = 0;
+    state->resource = SIM_NO_RESOURCE;
+    sim_free_all_tiles(state);
+
+    // Player starts in the center tile.
+    Sim_Player *player = &state->player;
+    player->head = new_vec2i(state->width / 2, state->height / 2);
+    player->tail_length = 0;
+    player->body_head = 0;
+    u32 head = sim_tile_index(state, player->head);
+    sim_get_body(state)[0] = head;
+    sim_occupy_tile(state, head);
+    state->hash ^= sim_get_zobrist_key(SIM_ZOBRIST_HEAD, head);
+
+    // Reset resource. (move to new random tile)
+    sim_move_resource_to_rand_pos(state);
+}
+
+u32 sim_step(Sim_State *state, Sim_Input input) {
+    ZoneScoped;
+
+    return step_kernels[state->kernel].step(state, input);
+}
+
+Vec2i sim_input_direction(Sim_Input input) {
+    switch (input) {
+        case SIM_INPUT_UP:    return new_vec2i(0, 1);
+        case SIM_INPUT_DOWN:  return new_vec2i(0, -1);
+        case SIM_INPUT_LEFT:  return new_vec2i(-1, 0);
+        case SIM_INPUT_RIGHT: return new_vec2i(1, 0);
+        default:              return new_vec2i(0, 0);
+    }
+}
+
+// Direction of the last move, from the first tail to the head.
+// SIM_INPUT_NONE without tails, since then any direction is safe.
+Sim_Input sim_get_heading(Sim_State *state) {
+    Sim_Player *player = &state->player;
+    if (player->tail_length == 0) {
+        return SIM_INPUT_NONE;
+    }
+
+    Vec2i neck = sim_index_tile(state, sim_get_tail(state, 0));
+    int dx = player->head.x - neck.x;
+    int dy = player->head.y - neck.y;
+    if (dx > 0) return SIM_INPUT_RIGHT;
+    if (dx < 0) return SIM_INPUT_LEFT;
+    if (dy > 0) return SIM_INPUT_UP;
+    return SIM_INPUT_DOWN;
+}
+
+// True when 'to' turns straight back from 'from'.
+bool sim_is_reversal(Sim_Input from, Sim_Input to) {
+    Vec2i a = sim_input_direction(from);
+    Vec2i b = sim_input_direction(to);
+    return (a.x != 0 || a.y != 0) && (a.x == -b.x) && (a.y == -b.y);
+}
+
+// Squares are relative to the center tile and get clamped to the playable area.
+void sim_move_resource_from_origin(Sim_State *state, int squares_right, int squares_up) {
+    ZoneScoped;
+
+    Vec2i tile;
+    tile.x = glm::clamp(state->width / 2 + squares_right, 0, state->width - 1);
+    tile.y = glm::clamp(state->height / 2 + squares_up, 0, state->height - 1);
+    sim_set_resource(state, sim_tile_index(state, tile));
+}
+
+// Picks uniformly among free tiles. Returns false when there are none left,
+// in which case the board is full and there's no resource anymore.
+bool sim_move_resource_to_rand_pos(Sim_State *state) {
+    ZoneScoped;
+
+    // Occupied tiles are the player's head and all of its tails,
+    // which also covers old resource position since player stands on it.
+    if (state->free_count == 0) {
+        sim_set_resource(state, SIM_NO_RESOURCE);
+        return false;
+    }
+
+    sim_set_resource(state, sim_get_free_tiles(state)[sim_rng_bounded(&state->rng, state->free_count)]);
+    return true;
+}
+
+// tiles[0] is the head, the rest are tails in order.
+// Tiles are expected to be in bounds and connected.
+void sim_place_player(Sim_State *state, const Vec2i *tiles, int count) {
+    ZoneScoped;
+
+    assert(count >= 1 && (u32)count <= state->tiles_count);
+
+    Sim_Player *player = &state->player;
+    player->head = tiles[0];
+    player->tail_length = count - 1;
+    player->body_head = player->tail_length;
+    u32 *body = sim_get_body(state);
+    For (count) {
+        body[player->body_head - it] = sim_tile_index(state, tiles[it]);
+    }
+
+    sim_rebuild_occupancy(state);
+}
+
+// Head and tails have to be on tiles of their own, 'sim_occupy_tile()' only
+// takes free ones.
+void sim_rebuild_occupancy(Sim_State *state) {
+    ZoneScoped;
+
+    sim_free_all_tiles(state);
+    sim_occupy_tile(state, sim_get_head(state));
+    For (state->player.tail_length) {
+        u32 tail = sim_get_tail(state, it);
+        assert(!sim_tile_occupied(state, tail));
+        sim_occupy_tile(state, tail);
+    }
+    state->hash ^= sim_get_zobrist_key(SIM_ZOBRIST_HEAD, sim_get_head(state));
+}
+
+// Hash is left with just the resource in it, there's no player anymore.
+void sim_free_all_tiles(Sim_State *state) {
+    ZoneScoped;
+
+    state->hash = (state->resource != SIM_NO_RESOURCE) ? sim_get_zobrist_key(SIM_ZOBRIST_RESOURCE, state->resource) : 0;
+    memset(sim_get_occupancy(state), 0, ((state->tiles_count + 63) / 64) * sizeof(u64));
+
+    u32 *free_tiles = sim_get_free_tiles(state);
+    u32 *free_slot = sim_get_free_slot(state);
+    state->free_count = state->tiles_count;
+    for (u32 it = 0; it < state->tiles_count; it++) {
+        free_tiles[it] = it;
+        free_slot[it] = it;
+    }
+}
+
+// 'hash' made from scratch in O(player length), for states that were
+// put together by hand. Otherwise it's always equal to 'state->hash'.
+u64 sim_compute_hash(Sim_State *state) {
+    u32 head = sim_get_head(state);
+    u64 hash = sim_get_zobrist_key(SIM_ZOBRIST_BODY, head) ^ sim_get_zobrist_key(SIM_ZOBRIST_HEAD, head);
+    For (state->player.tail_length) {
+        hash ^= sim_get_zobrist_key(SIM_ZOBRIST_BODY, sim_get_tail(state, it));
+    }
+    if (state->resource != SIM_NO_RESOURCE) {
+        hash ^= sim_get_zobrist_key(SIM_ZOBRIST_RESOURCE, state->resource);
+    }
+    return hash;
+}
+
+// Same seeding as the reference PCG32 implementation.
+void sim_rng_seed(Sim_Rng *rng, u64 seed, u64 stream) {
+    rng->state = 0;
+    rng->increment = (stream << 1) | 1;
+    sim_rng_next(rng);
+    rng->state += seed;
+    sim_rng_next(rng);
+}
@@ -0,0 +1,314 @@
+#ifndef SNAKE_SIM_H
+#define SNAKE_SIM_H
+
+// Headless simulation core.
+//
+// Everything the game rules touch lives in 'Sim_State', and the only way
+// to advance it is 'sim_step()'. This file must not depend on GLFW, GLEW,
+// FreeType or ImGui so it can be built as a static library and driven
+// by servers, bots and benchmarks without opening a window.
+
+#include <tracy/Tracy.hpp>
+
+#define YPL_TYPES_BY_TYPEDEF
+#define YPL_TYPES_USING_EXACT
+#include "ypl_types.h"
+#include "math.h"
+
+#define For(x) for(int it = 0; it < x; it++)
+#define ForFrom(x, n) for(int it = n; it < x; it++)
+#define ArrayCount(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+//
+// --- Constants ---
+//
+
+// Board size is picked per session, in tiles.
+const int SIM_BOARD_SIDE_MIN = 2;
+const int SIM_BOARD_SIDE_MAX = 4096;
+const int SIM_DEFAULT_BOARD_WIDTH = 15;
+const int SIM_DEFAULT_BOARD_HEIGHT = 9;
+
+// Marks that there is no resource on the board (every tile is taken by the player).
+const u32 SIM_NO_RESOURCE = U32_MAX;
+
+// Roles a tile can have in the state hash, see 'sim_get_zobrist_key()'.
+const u32 SIM_ZOBRIST_BODY = 0; // Head or any tail.
+const u32 SIM_ZOBRIST_HEAD = 1;
+const u32 SIM_ZOBRIST_RESOURCE = 2;
+
+//
+// --- Structs ---
+//
+struct Memory_Arena;
+struct Sim_Rng;
+struct Sim_Player;
+struct Sim_State;
+
+// Linear allocator, everything in it is freed at once with 'clear_memory_arena()'.
+struct Memory_Arena {
+    u8 *data;
+    u64 capacity;
+    u64 size;
+};
+
+// PCG32 (XSH RR variant). Every game owns its generator, so runs are
+// reproducible from the seed and separate games never share state.
+struct Sim_Rng {
+    u64 state;
+    u64 increment; // Selects the stream, must be odd.
+};
+
+// Tiles are integer grid coordinates with [0, 0] in the bottom-left corner
+// of the playable area. Simulation stores them packed as row-major indices,
+// converting to world space is up to the renderer.
+
+// Player's head and tails are stored as a ring buffer of tile indices
+// ('sim_get_body()'). Moving pushes the new head and drops the oldest tail
+// by keeping 'tail_length' the same. Eating just grows 'tail_length' instead.
+// Capacity is a power of two that fits every tile, so wrapping is a mask.
+struct Sim_Player {
+    Vec2i head; // Same tile as the newest body entry, so bounds checks don't divide.
+    int tail_length;
+    u32 body_head; // Index of the head in the body, tails follow it backwards.
+    u32 body_mask;
+};
+
+// The whole game is one contiguous block made by 'sim_init()': this struct,
+// then its board-sized arrays at fixed offsets from it. There are no pointers
+// inside, so copying 'size' bytes from one state to another of the same board
+// is a complete checkpoint, see 'sim_copy_state()'. Nothing in the per-tick
+// path depends on board area.
+struct Sim_State {
+    u64 size; // Bytes of the whole block, arrays included.
+    u64 seed; // What 'sim_reset()' was called with.
+    Sim_Rng rng;
+
+    int width;
+    int height;
+    u32 tiles_count;
+    u32 kernel; // Sim_Kernel that 'sim_step()' runs, picked from the board size.
+
+    Sim_Player player;
+    u32 resource;
+
+    // Dense list of tiles not taken by the player ('sim_get_free_tiles()'),
+    // so spawning is a single random pick. 'sim_get_free_slot()' maps a tile
+    // back to its place in the list and is only valid while the tile is free.
+    u32 free_count;
+
+    int score;
+    int moves;
+    u64 tick;
+
+    // Zobrist hash of the position: every body tile, the head tile and the
+    // resource tile, XOR-ed together. Kept up to date by every change to them,
+    // so equal positions have equal hashes no matter how they were reached.
+    // Score, moves and the random state aren't part of it.
+    u64 hash;
+
+    // Byte offsets of the arrays from the start of the state.
+    u32 body_offset;
+    u32 occupancy_offset; // One bit per tile, set while any part of the player occupies it.
+    u32 free_tiles_offset;
+    u32 free_slot_offset;
+};
+
+enum Sim_Input {
+    SIM_INPUT_NONE = 0,
+    SIM_INPUT_UP = 1,
+    SIM_INPUT_DOWN = 2,
+    SIM_INPUT_LEFT = 3,
+    SIM_INPUT_RIGHT = 4,
+};
+
+// 'sim_step()' returns a combination of these flags, so the caller
+// decides how to report what happened (the simulation itself never prints).
+enum Sim_Event_Flag {
+    SIM_EVENT_NONE = 0,
+    SIM_EVENT_MOVED = (1 << 0),
+    SIM_EVENT_RESOURCE_PICKED = (1 << 1),
+    SIM_EVENT_DIED = (1 << 2),
+    SIM_EVENT_WON = (1 << 3), // Player took every tile, nowhere to spawn a resource.
+};
+
+// Specialized versions of 'sim_step()'. 'sim_init()' picks one from the board
+// size, setting 'kernel' to SIM_KERNEL_GENERIC afterwards is always valid.
+enum Sim_Kernel {
+    SIM_KERNEL_GENERIC = 0,
+    SIM_KERNEL_FIXED_15X9 = 1, // Default board.
+    SIM_KERNEL_FIXED_16X16 = 2,
+    SIM_KERNEL_FIXED_32X32 = 3,
+    SIM_KERNEL_POW2_WIDTH_FIRST = 4, // Widths 2, 4, ... 4096 with any height follow in order.
+    SIM_KERNEL_COUNT = SIM_KERNEL_POW2_WIDTH_FIRST + 12,
+};
+
+//
+// --- Functions ---
+//
+Memory_Arena alloc_memory_arena(u64 capacity);
+void free_memory_arena(Memory_Arena *arena);
+void clear_memory_arena(Memory_Arena *arena);
+void *push_memory_arena(Memory_Arena *arena, u64 size);
+u64 sim_get_state_size(int width, int height);
+u64 sim_get_memory_size(int width, int height);
+Sim_State *sim_init(Memory_Arena *arena, int width, int height);
+void sim_reset(Sim_State *state, u64 seed);
+void sim_copy_state(Sim_State *to, Sim_State *from);
+bool sim_check_state(Sim_State *state, u64 bytes);
+u32 sim_step(Sim_State *state, Sim_Input input);
+u32 sim_pick_kernel(int width, int height);
+const char *sim_get_kernel_name(u32 kernel);
+Vec2i sim_input_direction(Sim_Input input);
+Sim_Input sim_get_heading(Sim_State *state);
+bool sim_is_reversal(Sim_Input from, Sim_Input to);
+void sim_move_resource_from_origin(Sim_State *state, int squares_right, int squares_up);
+bool sim_move_resource_to_rand_pos(Sim_State *state);
+void sim_place_player(Sim_State *state, const Vec2i *tiles, int count);
+void sim_rebuild_occupancy(Sim_State *state);
+void sim_free_all_tiles(Sim_State *state);
+u64 sim_compute_hash(Sim_State *state);
+void sim_rng_seed(Sim_Rng *rng, u64 seed, u64 stream);
+/*inline*/ constexpr u32 sim_get_body_capacity(u32 tiles_count);
+/*inline*/ u32 sim_rng_next(Sim_Rng *rng);
+/*inline*/ u32 sim_rng_bounded(Sim_Rng *rng, u32 bound);
+/*inline*/ u32 *sim_get_body(Sim_State *state);
+/*inline*/ u64 *sim_get_occupancy(Sim_State *state);
+/*inline*/ u32 *sim_get_free_tiles(Sim_State *state);
+/*inline*/ u32 *sim_get_free_slot(Sim_State *state);
+/*inline*/ u32 sim_get_head(Sim_State *state);
+/*inline*/ u32 sim_get_tail(Sim_State *state, int n);
+/*inline*/ bool sim_tile_in_bounds(Sim_State *state, Vec2i tile);
+/*inline*/ u32 sim_tile_index(Sim_State *state, Vec2i tile);
+/*inline*/ Vec2i sim_index_tile(Sim_State *state, u32 index);
+/*inline*/ bool sim_tile_occupied(Sim_State *state, u32 index);
+/*inline*/ void sim_occupy_tile(Sim_State *state, u32 index);
+/*inline*/ void sim_free_tile(Sim_State *state, u32 index);
+/*inline*/ u64 sim_get_zobrist_key(u32 role, u32 index);
+/*inline*/ void sim_set_resource(Sim_State *state, u32 index);
+
+//
+// --- Implementations ---
+//
+
+// Power of two that fits every tile, so the body ring buffer wraps with a mask.
+inline constexpr u32 sim_get_body_capacity(u32 tiles_count) {
+    u32 capacity = 1;
+    while (capacity < tiles_count) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+inline u32 sim_rng_next(Sim_Rng *rng) {
+    u64 old = rng->state;
+    rng->state = old * 6364136223846793005ull + rng->increment;
+    u32 xorshifted = (u32)(((old >> 18) ^ old) >> 27);
+    u32 rotation = (u32)(old >> 59);
+    return (xorshifted >> rotation) | (xorshifted << ((0u - rotation) & 31));
+}
+
+// Uniform in [0, bound) without modulo bias (Lemire's multiply-and-reject).
+// Rejection only happens for the few values below 2^32 % bound.
+inline u32 sim_rng_bounded(Sim_Rng *rng, u32 bound) {
+    u64 product = (u64)sim_rng_next(rng) * bound;
+    u32 low = (u32)product;
+    if (low < bound) {
+        u32 threshold = (0u - bound) % bound;
+        while (low < threshold) {
+            product = (u64)sim_rng_next(rng) * bound;
+            low = (u32)product;
+        }
+    }
+    return (u32)(product >> 32);
+}
+
+// Key of a tile in one of the SIM_ZOBRIST_ roles. It's SplitMix64 of the
+// tile and role rather than a lookup, so there's no table to size for the
+// board or to copy with the state, and keys never change between runs.
+inline u64 sim_get_zobrist_key(u32 role, u32 index) {
+    u64 key = (((u64)index << 2) | role) + 0x9E3779B97F4A7C15ull;
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ull;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBull;
+    return key ^ (key >> 31);
+}
+
+inline u32 *sim_get_body(Sim_State *state) {
+    return (u32 *)((u8 *)state + state->body_offset);
+}
+
+inline u64 *sim_get_occupancy(Sim_State *state) {
+    return (u64 *)((u8 *)state + state->occupancy_offset);
+}
+
+inline u32 *sim_get_free_tiles(Sim_State *state) {
+    return (u32 *)((u8 *)state + state->free_tiles_offset);
+}
+
+inline u32 *sim_get_free_slot(Sim_State *state) {
+    return (u32 *)((u8 *)state + state->free_slot_offset);
+}
+
+inline u32 sim_get_head(Sim_State *state) {
+    Sim_Player *player = &state->player;
+    return sim_get_body(state)[player->body_head];
+}
+
+// n = 0 is the tail right after the head, n = tail_length-1 is the last one.
+inline u32 sim_get_tail(Sim_State *state, int n) {
+    Sim_Player *player = &state->player;
+    return sim_get_body(state)[(player->body_head - 1 - n) & player->body_mask];
+}
+
+inline bool sim_tile_in_bounds(Sim_State *state, Vec2i tile) {
+    // Negative values wrap around to huge unsigned ones.
+    return ((u32)tile.x < (u32)state->width) && ((u32)tile.y < (u32)state->height);
+}
+
+inline u32 sim_tile_index(Sim_State *state, Vec2i tile) {
+    return (u32)tile.y * (u32)state->width + (u32)tile.x;
+}
+
+inline Vec2i sim_index_tile(Sim_State *state, u32 index) {
+    return new_vec2i(index % (u32)state->width, index / (u32)state->width);
+}
+
+inline bool sim_tile_occupied(Sim_State *state, u32 index) {
+    return (sim_get_occupancy(state)[index >> 6] >> (index & 63)) & 1;
+}
+
+// Tile must be free. Its slot in the free list is filled with the last free tile.
+inline void sim_occupy_tile(Sim_State *state, u32 index) {
+    u32 *free_tiles = sim_get_free_tiles(state);
+    u32 *free_slot = sim_get_free_slot(state);
+    sim_get_occupancy(state)[index >> 6] |= (1ull << (index & 63));
+    state->hash ^= sim_get_zobrist_key(SIM_ZOBRIST_BODY, index);
+
+    u32 slot = free_slot[index];
+    u32 last = free_tiles[--state->free_count];
+    free_tiles[slot] = last;
+    free_slot[last] = slot;
+}
+
+// Tile must be occupied.
+inline void sim_free_tile(Sim_State *state, u32 index) {
+    sim_get_occupancy(state)[index >> 6] &= ~(1ull << (index & 63));
+    state->hash ^= sim_get_zobrist_key(SIM_ZOBRIST_BODY, index);
+
+    sim_get_free_tiles(state)[state->free_count] = index;
+    sim_get_free_slot(state)[index] = state->free_count;
+    state->free_count++;
+}
+
+// Index can be SIM_NO_RESOURCE.
+inline void sim_set_resource(Sim_State *state, u32 index) {
+    if (state->resource != SIM_NO_RESOURCE) {
+        state->hash ^= sim_get_zobrist_key(SIM_ZOBRIST_RESOURCE, state->resource);
+    }
+    if (index != SIM_NO_RESOURCE) {
+        state->hash ^= sim_get_zobrist_key(SIM_ZOBRIST_RESOURCE, index);
+    }
+    state->resource = index;
+}
+
+#endif /*SNAKE_SIM_H*/
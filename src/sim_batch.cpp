@@ -0,0 +1,632 @@
+// assert()
+#include <assert.h>
+// memset(), memcpy()
+#include <string.h>
+
+#include "sim_batch.h"
+
+// SIMD kernels are compiled for their instruction set whatever the project
+// flags are, and only ever run after the CPU said it supports it.
+#if defined(_M_X64) || defined(__x86_64__)
+#define SIM_BATCH_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SIM_BATCH_TARGET_AVX2
+#define SIM_BATCH_TARGET_AVX512
+#else
+#include <cpuid.h>
+#define SIM_BATCH_TARGET_AVX2 __attribute__((target("avx2")))
+#define SIM_BATCH_TARGET_AVX512 __attribute__((target("avx2,avx512f")))
+#endif
+#else
+#define SIM_BATCH_X86 0
+#endif
+
+//
+// --- Single game ---
+//
+
+// Same as the 'Sim_State' versions in 'sim.h', on one game of the batch.
+
+static inline bool batch_tile_occupied(Sim_Batch *batch, u32 game, u32 index) {
+    u32 *occupancy = batch->occupancy + (u64)game * batch->occupancy_words;
+    return (occupancy[index >> 5] >> (index & 31)) & 1;
+}
+
+static inline void batch_occupy_tile(Sim_Batch *batch, u32 game, u32 index) {
+    u32 *occupancy = batch->occupancy + (u64)game * batch->occupancy_words;
+    u32 *free_tiles = batch->free_tiles + (u64)game * batch->tiles_count;
+    u32 *free_slot = batch->free_slot + (u64)game * batch->tiles_count;
+    occupancy[index >> 5] |= (1u << (index & 31));
+
+    u32 slot = free_slot[index];
+    u32 last = free_tiles[--batch->free_count[game]];
+    free_tiles[slot] = last;
+    free_slot[last] = slot;
+}
+
+static inline void batch_free_tile(Sim_Batch *batch, u32 game, u32 index) {
+    u32 *occupancy = batch->occupancy + (u64)game * batch->occupancy_words;
+    u32 *free_tiles = batch->free_tiles + (u64)game * batch->tiles_count;
+    u32 *free_slot = batch->free_slot + (u64)game * batch->tiles_count;
+    occupancy[index >> 5] &= ~(1u << (index & 31));
+
+    free_tiles[batch->free_count[game]] = index;
+    free_slot[index] = batch->free_count[game];
+    batch->free_count[game]++;
+}
+
+// Returns false when the board is full, see 'sim_move_resource_to_rand_pos()'.
+static bool batch_spawn_resource(Sim_Batch *batch, u32 game) {
+    u32 free_count = batch->free_count[game];
+    if (free_count == 0) {
+        batch->resource[game] = SIM_NO_RESOURCE;
+        return false;
+    }
+
+    Sim_Rng rng;
+    rng.state = batch->rng_state[game];
+    rng.increment = batch->rng_increment[game];
+    u32 *free_tiles = batch->free_tiles + (u64)game * batch->tiles_count;
+    batch->resource[game] = free_tiles[sim_rng_bounded(&rng, free_count)];
+    batch->rng_state[game] = rng.state;
+    return true;
+}
+
+// Rest of the move once the head was checked to land on 'index', a free tile.
+// 'last' is where the player's last part was before the move.
+// Returns events on top of SIM_EVENT_MOVED.
+static u32 batch_finish_move(Sim_Batch *batch, u32 game, u32 index, u32 last) {
+    u32 body_mask = batch->body_capacity - 1;
+    u32 *body = batch->body + (u64)game * batch->body_capacity;
+
+    batch_occupy_tile(batch, game, index);
+    batch->body_head[game] = (batch->body_head[game] + 1) & body_mask;
+    body[batch->body_head[game]] = index;
+
+    if (index == batch->resource[game]) {
+        batch->tail_length[game]++;
+        batch->score[game]++;
+        if (!batch_spawn_resource(batch, game)) {
+            batch->done[game] = 1;
+            return SIM_EVENT_RESOURCE_PICKED | SIM_EVENT_WON;
+        }
+        return SIM_EVENT_RESOURCE_PICKED;
+    }
+
+    batch_free_tile(batch, game, last);
+    return SIM_EVENT_NONE;
+}
+
+// 'step_kernel()' from 'sim.cpp' on one game of the batch.
+static u32 batch_step_game(Sim_Batch *batch, u32 game, u32 input) {
+    Vec2i direction = sim_input_direction((Sim_Input)input);
+    if (batch->done[game] || (direction.x == 0 && direction.y == 0)) {
+        return SIM_EVENT_NONE;
+    }
+
+    u32 body_mask = batch->body_capacity - 1;
+    u32 *body = batch->body + (u64)game * batch->body_capacity;
+    u32 last = body[(batch->body_head[game] - batch->tail_length[game]) & body_mask];
+
+    int x = batch->head_x[game] + direction.x;
+    int y = batch->head_y[game] + direction.y;
+    batch->head_x[game] = x;
+    batch->head_y[game] = y;
+    batch->moves[game]++;
+
+    if ((u32)x >= (u32)batch->width || (u32)y >= (u32)batch->height) {
+        batch->done[game] = 1;
+        return SIM_EVENT_MOVED | SIM_EVENT_DIED;
+    }
+
+    u32 index = (u32)y * (u32)batch->width + (u32)x;
+    if (batch_tile_occupied(batch, game, index)) {
+        batch->done[game] = 1;
+        return SIM_EVENT_MOVED | SIM_EVENT_DIED;
+    }
+
+    return SIM_EVENT_MOVED | batch_finish_move(batch, game, index, last);
+}
+
+//
+// --- Batch kernels ---
+//
+
+// Every kernel steps games from the first one on in groups of its width,
+// and returns how many it got through. 'sim_batch_step()' does the rest
+// one by one.
+
+static u32 step_batch_scalar(Sim_Batch *batch, const u8 *inputs, u8 *events) {
+    for (u32 game = 0; game < batch->games_count; game++) {
+        events[game] = (u8)batch_step_game(batch, game, inputs[game]);
+    }
+    return batch->games_count;
+}
+
+#if SIM_BATCH_X86
+
+// Moves heads, tests walls and collisions for 8 games at once with gathers.
+// AVX2 has no scatters, so games that moved onto a free tile finish their
+// move one by one.
+SIM_BATCH_TARGET_AVX2
+static u32 step_batch_avx2(Sim_Batch *batch, const u8 *inputs, u8 *events) {
+    const __m256i direction_x = _mm256_setr_epi32(0, 0, 0, -1, 1, 0, 0, 0); // Indexed by Sim_Input.
+    const __m256i direction_y = _mm256_setr_epi32(0, 1, -1, 0, 0, 0, 0, 0);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i all = _mm256_set1_epi32(-1);
+    const __m256i width = _mm256_set1_epi32(batch->width);
+    const __m256i height = _mm256_set1_epi32(batch->height);
+    const __m256i body_mask = _mm256_set1_epi32(batch->body_capacity - 1);
+    const __m256i body_base = _mm256_mullo_epi32(lanes, _mm256_set1_epi32(batch->body_capacity));
+    const __m256i occupancy_base = _mm256_mullo_epi32(lanes, _mm256_set1_epi32(batch->occupancy_words));
+
+    u32 groups_end = batch->games_count & ~7u;
+    for (u32 game = 0; game < groups_end; game += 8) {
+        __m256i input = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(inputs + game)));
+        __m256i done = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(batch->done + game)));
+        __m256i dx = _mm256_permutevar8x32_epi32(direction_x, input);
+        __m256i dy = _mm256_permutevar8x32_epi32(direction_y, input);
+
+        __m256i idle = _mm256_or_si256(_mm256_cmpeq_epi32(_mm256_or_si256(dx, dy), zero), _mm256_cmpgt_epi32(done, zero));
+        __m256i active = _mm256_andnot_si256(idle, all);
+        int active_bits = _mm256_movemask_ps(_mm256_castsi256_ps(active));
+        if (active_bits == 0) {
+            memset(events + game, SIM_EVENT_NONE, 8);
+            continue;
+        }
+
+        const int *body = (const int *)(batch->body + (u64)game * batch->body_capacity);
+        const int *occupancy = (const int *)(batch->occupancy + (u64)game * batch->occupancy_words);
+
+        __m256i tail_length = _mm256_loadu_si256((const __m256i *)(batch->tail_length + game));
+        __m256i body_head = _mm256_loadu_si256((const __m256i *)(batch->body_head + game));
+        __m256i last_offset = _mm256_add_epi32(body_base, _mm256_and_si256(_mm256_sub_epi32(body_head, tail_length), body_mask));
+        __m256i last = _mm256_mask_i32gather_epi32(zero, body, last_offset, active, 4);
+
+        __m256i head_x = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(batch->head_x + game)), _mm256_and_si256(dx, active));
+        __m256i head_y = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(batch->head_y + game)), _mm256_and_si256(dy, active));
+        __m256i moves = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)(batch->moves + game)), active);
+        _mm256_storeu_si256((__m256i *)(batch->head_x + game), head_x);
+        _mm256_storeu_si256((__m256i *)(batch->head_y + game), head_y);
+        _mm256_storeu_si256((__m256i *)(batch->moves + game), moves);
+
+        __m256i in_bounds_x = _mm256_and_si256(_mm256_cmpgt_epi32(head_x, all), _mm256_cmpgt_epi32(width, head_x));
+        __m256i in_bounds_y = _mm256_and_si256(_mm256_cmpgt_epi32(head_y, all), _mm256_cmpgt_epi32(height, head_y));
+        __m256i check = _mm256_and_si256(active, _mm256_and_si256(in_bounds_x, in_bounds_y));
+
+        __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(head_y, width), head_x);
+        __m256i word_offset = _mm256_add_epi32(occupancy_base, _mm256_srli_epi32(index, 5));
+        __m256i word = _mm256_mask_i32gather_epi32(zero, occupancy, word_offset, check, 4);
+        __m256i bit = _mm256_sllv_epi32(one, _mm256_and_si256(index, _mm256_set1_epi32(31)));
+        __m256i moving = _mm256_and_si256(check, _mm256_cmpeq_epi32(_mm256_and_si256(word, bit), zero));
+        int moving_bits = _mm256_movemask_ps(_mm256_castsi256_ps(moving));
+
+        alignas(32) u32 indices[8];
+        alignas(32) u32 lasts[8];
+        _mm256_store_si256((__m256i *)indices, index);
+        _mm256_store_si256((__m256i *)lasts, last);
+        For (8) {
+            u32 lane_events = SIM_EVENT_NONE;
+            if ((moving_bits >> it) & 1) {
+                lane_events = SIM_EVENT_MOVED | batch_finish_move(batch, game + it, indices[it], lasts[it]);
+            } else if ((active_bits >> it) & 1) {
+                lane_events = SIM_EVENT_MOVED | SIM_EVENT_DIED;
+                batch->done[game + it] = 1;
+            }
+            events[game + it] = (u8)lane_events;
+        }
+    }
+    return groups_end;
+}
+
+// Whole move for 16 games at once. Lanes are separate games, so gathers and
+// scatters in one instruction never touch the same memory, and each lane
+// sees its own earlier scatters. Only resource spawns go one by one,
+// they are rare and draw from each game's own generator.
+SIM_BATCH_TARGET_AVX512
+static u32 step_batch_avx512(Sim_Batch *batch, const u8 *inputs, u8 *events) {
+    const __m512i direction_x = _mm512_setr_epi32(0, 0, 0, -1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0); // Indexed by Sim_Input.
+    const __m512i direction_y = _mm512_setr_epi32(0, 1, -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i one = _mm512_set1_epi32(1);
+    const __m512i width = _mm512_set1_epi32(batch->width);
+    const __m512i height = _mm512_set1_epi32(batch->height);
+    const __m512i bit_mask = _mm512_set1_epi32(31);
+    const __m512i body_mask = _mm512_set1_epi32(batch->body_capacity - 1);
+    const __m512i body_base = _mm512_mullo_epi32(lanes, _mm512_set1_epi32(batch->body_capacity));
+    const __m512i occupancy_base = _mm512_mullo_epi32(lanes, _mm512_set1_epi32(batch->occupancy_words));
+    const __m512i free_base = _mm512_mullo_epi32(lanes, _mm512_set1_epi32(batch->tiles_count));
+    const __m512i moved_event = _mm512_set1_epi32(SIM_EVENT_MOVED);
+    const __m512i died_event = _mm512_set1_epi32(SIM_EVENT_MOVED | SIM_EVENT_DIED);
+    const __m512i picked_event = _mm512_set1_epi32(SIM_EVENT_MOVED | SIM_EVENT_RESOURCE_PICKED);
+
+    u32 groups_end = batch->games_count & ~15u;
+    for (u32 game = 0; game < groups_end; game += 16) {
+        __m512i input = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)(inputs + game)));
+        __m512i done = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)(batch->done + game)));
+        __m512i dx = _mm512_permutexvar_epi32(input, direction_x);
+        __m512i dy = _mm512_permutexvar_epi32(input, direction_y);
+        __m512i direction = _mm512_or_si512(dx, dy);
+
+        __mmask16 was_done = _mm512_test_epi32_mask(done, done);
+        __mmask16 active = _mm512_mask_test_epi32_mask((__mmask16)~was_done, direction, direction);
+        if (active == 0) {
+            memset(events + game, SIM_EVENT_NONE, 16);
+            continue;
+        }
+
+        int *body = (int *)(batch->body + (u64)game * batch->body_capacity);
+        int *occupancy = (int *)(batch->occupancy + (u64)game * batch->occupancy_words);
+        int *free_tiles = (int *)(batch->free_tiles + (u64)game * batch->tiles_count);
+        int *free_slot = (int *)(batch->free_slot + (u64)game * batch->tiles_count);
+
+        __m512i tail_length = _mm512_loadu_si512(batch->tail_length + game);
+        __m512i body_head = _mm512_loadu_si512(batch->body_head + game);
+        __m512i resource = _mm512_loadu_si512(batch->resource + game);
+        __m512i free_count = _mm512_loadu_si512(batch->free_count + game);
+        __m512i score = _mm512_loadu_si512(batch->score + game);
+        __m512i moves = _mm512_loadu_si512(batch->moves + game);
+        __m512i head_x = _mm512_loadu_si512(batch->head_x + game);
+        __m512i head_y = _mm512_loadu_si512(batch->head_y + game);
+
+        __m512i last_offset = _mm512_add_epi32(body_base, _mm512_and_si512(_mm512_sub_epi32(body_head, tail_length), body_mask));
+        __m512i last = _mm512_mask_i32gather_epi32(zero, active, last_offset, body, 4);
+
+        head_x = _mm512_mask_add_epi32(head_x, active, head_x, dx);
+        head_y = _mm512_mask_add_epi32(head_y, active, head_y, dy);
+        moves = _mm512_mask_add_epi32(moves, active, moves, one);
+        __mmask16 check = _mm512_mask_cmplt_epu32_mask(active, head_x, width) & _mm512_cmplt_epu32_mask(head_y, height);
+
+        __m512i index = _mm512_add_epi32(_mm512_mullo_epi32(head_y, width), head_x);
+        __m512i word_offset = _mm512_add_epi32(occupancy_base, _mm512_srli_epi32(index, 5));
+        __m512i word = _mm512_mask_i32gather_epi32(zero, check, word_offset, occupancy, 4);
+        __m512i bit = _mm512_sllv_epi32(one, _mm512_and_si512(index, bit_mask));
+        __mmask16 moving = _mm512_mask_testn_epi32_mask(check, word, bit);
+        __mmask16 died = active & ~moving;
+
+        // Occupy the new head tile, taking it out of the free list.
+        _mm512_mask_i32scatter_epi32(occupancy, moving, word_offset, _mm512_or_si512(word, bit), 4);
+        free_count = _mm512_mask_sub_epi32(free_count, moving, free_count, one);
+        __m512i slot = _mm512_mask_i32gather_epi32(zero, moving, _mm512_add_epi32(free_base, index), free_slot, 4);
+        __m512i last_free = _mm512_mask_i32gather_epi32(zero, moving, _mm512_add_epi32(free_base, free_count), free_tiles, 4);
+        _mm512_mask_i32scatter_epi32(free_tiles, moving, _mm512_add_epi32(free_base, slot), last_free, 4);
+        _mm512_mask_i32scatter_epi32(free_slot, moving, _mm512_add_epi32(free_base, last_free), slot, 4);
+
+        body_head = _mm512_mask_and_epi32(body_head, moving, _mm512_add_epi32(body_head, one), body_mask);
+        _mm512_mask_i32scatter_epi32(body, moving, _mm512_add_epi32(body_base, body_head), index, 4);
+
+        __mmask16 picked = _mm512_mask_cmpeq_epi32_mask(moving, index, resource);
+        __mmask16 shrinking = moving & ~picked;
+
+        // Free the tile the last part left. Its word is gathered again,
+        // the head could have just set a bit in the same one.
+        __m512i last_word_offset = _mm512_add_epi32(occupancy_base, _mm512_srli_epi32(last, 5));
+        __m512i last_word = _mm512_mask_i32gather_epi32(zero, shrinking, last_word_offset, occupancy, 4);
+        __m512i last_bit = _mm512_sllv_epi32(one, _mm512_and_si512(last, bit_mask));
+        _mm512_mask_i32scatter_epi32(occupancy, shrinking, last_word_offset, _mm512_andnot_si512(last_bit, last_word), 4);
+        _mm512_mask_i32scatter_epi32(free_tiles, shrinking, _mm512_add_epi32(free_base, free_count), last, 4);
+        _mm512_mask_i32scatter_epi32(free_slot, shrinking, _mm512_add_epi32(free_base, last), free_count, 4);
+        free_count = _mm512_mask_add_epi32(free_count, shrinking, free_count, one);
+
+        tail_length = _mm512_mask_add_epi32(tail_length, picked, tail_length, one);
+        score = _mm512_mask_add_epi32(score, picked, score, one);
+
+        _mm512_storeu_si512(batch->tail_length + game, tail_length);
+        _mm512_storeu_si512(batch->body_head + game, body_head);
+        _mm512_storeu_si512(batch->free_count + game, free_count);
+        _mm512_storeu_si512(batch->score + game, score);
+        _mm512_storeu_si512(batch->moves + game, moves);
+        _mm512_storeu_si512(batch->head_x + game, head_x);
+        _mm512_storeu_si512(batch->head_y + game, head_y);
+
+        __m512i done_flags = _mm512_maskz_mov_epi32(was_done | died, one);
+        _mm_storeu_si128((__m128i *)(batch->done + game), _mm512_cvtepi32_epi8(done_flags));
+
+        __m512i lane_events = _mm512_maskz_mov_epi32(active, moved_event);
+        lane_events = _mm512_mask_mov_epi32(lane_events, died, died_event);
+        lane_events = _mm512_mask_mov_epi32(lane_events, picked, picked_event);
+        _mm_storeu_si128((__m128i *)(events + game), _mm512_cvtepi32_epi8(lane_events));
+
+        if (picked) {
+            For (16) {
+                if (((picked >> it) & 1) && !batch_spawn_resource(batch, game + it)) {
+                    events[game + it] |= SIM_EVENT_WON;
+                    batch->done[game + it] = 1;
+                }
+            }
+        }
+    }
+    return groups_end;
+}
+
+#else
+
+// Never picked, 'sim_batch_kernel_supported()' says no outside x86.
+#define step_batch_avx2 step_batch_scalar
+#define step_batch_avx512 step_batch_scalar
+
+#endif
+
+struct Batch_Kernel {
+    const char *name;
+    u32 (*step)(Sim_Batch *batch, const u8 *inputs, u8 *events);
+};
+
+// Indexed by Sim_Batch_Kernel.
+static const Batch_Kernel batch_kernels[SIM_BATCH_KERNEL_COUNT] = {
+    { "scalar", step_batch_scalar },
+    { "avx2", step_batch_avx2 },
+    { "avx512", step_batch_avx512 },
+};
+
+//
+// --- CPU features ---
+//
+struct Cpu_Features {
+    bool avx2;
+    bool avx512;
+};
+
+#if SIM_BATCH_X86
+static void get_cpuid(u32 leaf, u32 subleaf, u32 *registers) {
+#if defined(_MSC_VER)
+    __cpuidex((int *)registers, (int)leaf, (int)subleaf);
+#else
+    __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+// Which register states the OS saves on context switches (XCR0).
+static u64 get_os_saved_states() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    u32 low, high;
+    __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+    return ((u64)high << 32) | low;
+#endif
+}
+#endif
+
+// The CPU has to have the instructions and the OS has to save their registers.
+static Cpu_Features detect_cpu_features() {
+    Cpu_Features features = {};
+#if SIM_BATCH_X86
+    u32 registers[4];
+    get_cpuid(0, 0, registers);
+    if (registers[0] < 7) {
+        return features;
+    }
+
+    get_cpuid(1, 0, registers);
+    bool os_saves_avx = (registers[2] >> 27) & 1; // OSXSAVE
+    bool has_avx = (registers[2] >> 28) & 1;
+    if (!os_saves_avx || !has_avx) {
+        return features;
+    }
+
+    u64 states = get_os_saved_states();
+    bool ymm_saved = (states & 0x06) == 0x06;
+    bool zmm_saved = (states & 0xE6) == 0xE6;
+
+    get_cpuid(7, 0, registers);
+    features.avx2 = ymm_saved && ((registers[1] >> 5) & 1);
+    features.avx512 = features.avx2 && zmm_saved && ((registers[1] >> 16) & 1); // AVX-512F
+#endif
+    return features;
+}
+
+static Cpu_Features get_cpu_features() {
+    static Cpu_Features features = detect_cpu_features();
+    return features;
+}
+
+//
+// --- Batch ---
+//
+
+// How much arena space 'sim_batch_init()' needs, alignment included.
+u64 sim_batch_get_memory_size(int width, int height, u32 games_count) {
+    u64 tiles_count = (u64)width * (u64)height;
+    u64 games = games_count;
+    u64 size = 0;
+    size += 8 * (games * sizeof(u32) + 63); // head_x ... moves
+    size += games * sizeof(u8) + 63;
+    size += 3 * (games * sizeof(u64) + 63);
+    size += games * sim_get_body_capacity((u32)tiles_count) * sizeof(u32) + 63;
+    size += games * ((tiles_count + 31) / 32) * sizeof(u32) + 63;
+    size += 2 * (games * tiles_count * sizeof(u32) + 63);
+    return size;
+}
+
+// Takes storage for 'games_count' games from 'arena' and picks the widest
+// kernel the CPU supports. Games start done, each has to be reset (or set)
+// before it moves. Returns false if the size is out of range or the arena
+// is too small, in which case 'batch' must not be used.
+bool sim_batch_init(Sim_Batch *batch, Memory_Arena *arena, int width, int height, u32 games_count) {
+    ZoneScoped;
+
+    if (width < SIM_BOARD_SIDE_MIN || width > SIM_BOARD_SIDE_MAX ||
+        height < SIM_BOARD_SIDE_MIN || height > SIM_BOARD_SIDE_MAX || games_count == 0) {
+        return false;
+    }
+
+    memset(batch, 0, sizeof(Sim_Batch));
+    batch->width = width;
+    batch->height = height;
+    batch->tiles_count = (u32)width * (u32)height;
+    batch->games_count = games_count;
+    batch->kernel = sim_batch_pick_kernel();
+    batch->body_capacity = sim_get_body_capacity(batch->tiles_count);
+    batch->occupancy_words = (batch->tiles_count + 31) / 32;
+
+    u64 games = games_count;
+    batch->head_x = (int *) push_memory_arena(arena, games * sizeof(int));
+    batch->head_y = (int *) push_memory_arena(arena, games * sizeof(int));
+    batch->tail_length = (int *) push_memory_arena(arena, games * sizeof(int));
+    batch->body_head = (u32 *) push_memory_arena(arena, games * sizeof(u32));
+    batch->resource = (u32 *) push_memory_arena(arena, games * sizeof(u32));
+    batch->free_count = (u32 *) push_memory_arena(arena, games * sizeof(u32));
+    batch->score = (int *) push_memory_arena(arena, games * sizeof(int));
+    batch->moves = (int *) push_memory_arena(arena, games * sizeof(int));
+    batch->done = (u8 *) push_memory_arena(arena, games * sizeof(u8));
+    batch->seed = (u64 *) push_memory_arena(arena, games * sizeof(u64));
+    batch->rng_state = (u64 *) push_memory_arena(arena, games * sizeof(u64));
+    batch->rng_increment = (u64 *) push_memory_arena(arena, games * sizeof(u64));
+    batch->body = (u32 *) push_memory_arena(arena, games * batch->body_capacity * sizeof(u32));
+    batch->occupancy = (u32 *) push_memory_arena(arena, games * batch->occupancy_words * sizeof(u32));
+    batch->free_tiles = (u32 *) push_memory_arena(arena, games * batch->tiles_count * sizeof(u32));
+    batch->free_slot = (u32 *) push_memory_arena(arena, games * batch->tiles_count * sizeof(u32));
+
+    if (!batch->head_x || !batch->head_y || !batch->tail_length || !batch->body_head ||
+        !batch->resource || !batch->free_count || !batch->score || !batch->moves || !batch->done ||
+        !batch->seed || !batch->rng_state || !batch->rng_increment ||
+        !batch->body || !batch->occupancy || !batch->free_tiles || !batch->free_slot) {
+        return false;
+    }
+
+    memset(batch->done, 1, games * sizeof(u8));
+    return true;
+}
+
+// Same start as 'sim_reset()' with the same seed. Costs O(board area).
+void sim_batch_reset_game(Sim_Batch *batch, u32 game, u64 seed) {
+    assert(game < batch->games_count);
+
+    Sim_Rng rng;
+    sim_rng_seed(&rng, seed, 0);
+    batch->seed[game] = seed;
+    batch->rng_state[game] = rng.state;
+    batch->rng_increment[game] = rng.increment;
+    batch->score[game] = 0;
+    batch->moves[game] = 0;
+    batch->done[game] = 0;
+
+    u32 *occupancy = batch->occupancy + (u64)game * batch->occupancy_words;
+    u32 *free_tiles = batch->free_tiles + (u64)game * batch->tiles_count;
+    u32 *free_slot = batch->free_slot + (u64)game * batch->tiles_count;
+    memset(occupancy, 0, batch->occupancy_words * sizeof(u32));
+    batch->free_count[game] = batch->tiles_count;
+    for (u32 it = 0; it < batch->tiles_count; it++) {
+        free_tiles[it] = it;
+        free_slot[it] = it;
+    }
+
+    // Player starts in the center tile.
+    u32 *body = batch->body + (u64)game * batch->body_capacity;
+    batch->head_x[game] = batch->width / 2;
+    batch->head_y[game] = batch->height / 2;
+    batch->tail_length[game] = 0;
+    batch->body_head[game] = 0;
+    body[0] = (u32)batch->head_y[game] * (u32)batch->width + (u32)batch->head_x[game];
+    batch_occupy_tile(batch, game, body[0]);
+
+    batch_spawn_resource(batch, game);
+}
+
+// Advances every game by one move. 'inputs' and 'events' have one entry per
+// game: a Sim_Input, and the Sim_Event_Flag combination 'sim_step()' would
+// have returned. Games that are done, or got SIM_INPUT_NONE, don't move.
+void sim_batch_step(Sim_Batch *batch, const u8 *inputs, u8 *events) {
+    ZoneScoped;
+
+    assert(sim_batch_kernel_supported(batch->kernel));
+    u32 stepped = batch_kernels[batch->kernel].step(batch, inputs, events);
+    for (u32 game = stepped; game < batch->games_count; game++) {
+        events[game] = (u8)batch_step_game(batch, game, inputs[game]);
+    }
+}
+
+// Copies one game out. 'state' has to be set up by 'sim_init()' for the
+// same board size, its kernel is kept.
+void sim_batch_get_game(Sim_Batch *batch, u32 game, Sim_State *state) {
+    assert(game < batch->games_count);
+    assert(state->width == batch->width && state->height == batch->height);
+
+    state->seed = batch->seed[game];
+    state->rng.state = batch->rng_state[game];
+    state->rng.increment = batch->rng_increment[game];
+
+    Sim_Player *player = &state->player;
+    player->head = new_vec2i(batch->head_x[game], batch->head_y[game]);
+    player->tail_length = batch->tail_length[game];
+    player->body_head = batch->body_head[game];
+    memcpy(sim_get_body(state), batch->body + (u64)game * batch->body_capacity, batch->body_capacity * sizeof(u32));
+
+    u32 *occupancy = batch->occupancy + (u64)game * batch->occupancy_words;
+    u64 *state_occupancy = sim_get_occupancy(state);
+    memset(state_occupancy, 0, ((state->tiles_count + 63) / 64) * sizeof(u64));
+    for (u32 it = 0; it < batch->occupancy_words; it++) {
+        state_occupancy[it >> 1] |= (u64)occupancy[it] << (32 * (it & 1));
+    }
+
+    state->resource = batch->resource[game];
+    state->free_count = batch->free_count[game];
+    memcpy(sim_get_free_tiles(state), batch->free_tiles + (u64)game * batch->tiles_count, batch->tiles_count * sizeof(u32));
+    memcpy(sim_get_free_slot(state), batch->free_slot + (u64)game * batch->tiles_count, batch->tiles_count * sizeof(u32));
+
+    state->score = batch->score[game];
+    state->moves = batch->moves[game];
+    state->tick = (u64)batch->moves[game];
+    state->hash = sim_compute_hash(state);
+}
+
+// Copies 'state' into one game of the batch, which continues from there.
+// Board sizes have to match.
+void sim_batch_set_game(Sim_Batch *batch, u32 game, Sim_State *state) {
+    assert(game < batch->games_count);
+    assert(state->width == batch->width && state->height == batch->height);
+
+    batch->seed[game] = state->seed;
+    batch->rng_state[game] = state->rng.state;
+    batch->rng_increment[game] = state->rng.increment;
+
+    Sim_Player *player = &state->player;
+    batch->head_x[game] = player->head.x;
+    batch->head_y[game] = player->head.y;
+    batch->tail_length[game] = player->tail_length;
+    batch->body_head[game] = player->body_head;
+    memcpy(batch->body + (u64)game * batch->body_capacity, sim_get_body(state), batch->body_capacity * sizeof(u32));
+
+    u32 *occupancy = batch->occupancy + (u64)game * batch->occupancy_words;
+    u64 *state_occupancy = sim_get_occupancy(state);
+    for (u32 it = 0; it < batch->occupancy_words; it++) {
+        occupancy[it] = (u32)(state_occupancy[it >> 1] >> (32 * (it & 1)));
+    }
+
+    batch->resource[game] = state->resource;
+    batch->free_count[game] = state->free_count;
+    memcpy(batch->free_tiles + (u64)game * batch->tiles_count, sim_get_free_tiles(state), batch->tiles_count * sizeof(u32));
+    memcpy(batch->free_slot + (u64)game * batch->tiles_count, sim_get_free_slot(state), batch->tiles_count * sizeof(u32));
+
+    batch->score[game] = state->score;
+    batch->moves[game] = state->moves;
+    batch->done[game] = 0;
+}
+
+// Widest kernel this CPU runs.
+u32 sim_batch_pick_kernel() {
+    if (sim_batch_kernel_supported(SIM_BATCH_KERNEL_AVX512)) return SIM_BATCH_KERNEL_AVX512;
+    if (sim_batch_kernel_supported(SIM_BATCH_KERNEL_AVX2))   return SIM_BATCH_KERNEL_AVX2;
+    return SIM_BATCH_KERNEL_SCALAR;
+}
+
+bool sim_batch_kernel_supported(u32 kernel) {
+    Cpu_Features features = get_cpu_features();
+    switch (kernel) {
+        case SIM_BATCH_KERNEL_SCALAR: return true;
+        case SIM_BATCH_KERNEL_AVX2:   return features.avx2;
+        case SIM_BATCH_KERNEL_AVX512: return features.avx512;
+        default:                      return false;
+    }
+}
+
+const char *sim_batch_get_kernel_name(u32 kernel) {
+    assert(kernel < SIM_BATCH_KERNEL_COUNT);
+    return batch_kernels[kernel].name;
+}
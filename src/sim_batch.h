@@ -0,0 +1,80 @@
+#ifndef SNAKE_SIM_BATCH_H
+#define SNAKE_SIM_BATCH_H
+
+// Lockstep batch of independent games for bots and evaluation.
+//
+// Every game in a batch plays on the same board size, and its state is laid
+// out as structure-of-arrays so one 'sim_batch_step()' advances 8 or 16 games
+// per instruction with the AVX2 or AVX-512 kernel. Rules are the ones of
+// 'sim_step()' down to the free tiles order and the random numbers drawn,
+// so a game copied out with 'sim_batch_get_game()' matches a 'Sim_State'
+// that got the same inputs.
+
+#include "sim.h"
+
+//
+// --- Constants ---
+//
+
+// Widest kernel, in games per instruction.
+const u32 SIM_BATCH_LANES_MAX = 16;
+
+//
+// --- Structs ---
+//
+struct Sim_Batch;
+
+// Arrays with one entry per game are indexed by game. Board-sized ones hold
+// every game back to back, game 'n' starts at 'n * stride'.
+struct Sim_Batch {
+    int width;
+    int height;
+    u32 tiles_count;
+    u32 games_count;
+    u32 kernel; // Sim_Batch_Kernel, picked from what the CPU supports.
+
+    u32 body_capacity; // Power of two, same as 'Sim_Player' uses for the board.
+    u32 occupancy_words; // 32-bit words, so kernels can gather them.
+
+    // Per game.
+    int *head_x;
+    int *head_y;
+    int *tail_length;
+    u32 *body_head;
+    u32 *resource;
+    u32 *free_count;
+    int *score;
+    int *moves;
+    u8 *done; // Set when the game died or was won, it doesn't move until reset.
+    u64 *seed;
+    u64 *rng_state;
+    u64 *rng_increment;
+
+    // Per game, board-sized.
+    u32 *body;       // Stride 'body_capacity'.
+    u32 *occupancy;  // Stride 'occupancy_words'.
+    u32 *free_tiles; // Stride 'tiles_count'.
+    u32 *free_slot;  // Stride 'tiles_count'.
+};
+
+enum Sim_Batch_Kernel {
+    SIM_BATCH_KERNEL_SCALAR = 0, // Always supported.
+    SIM_BATCH_KERNEL_AVX2 = 1,   // 8 games per instruction.
+    SIM_BATCH_KERNEL_AVX512 = 2, // 16 games per instruction, with scatters.
+    SIM_BATCH_KERNEL_COUNT = 3,
+};
+
+//
+// --- Functions ---
+//
+u64 sim_batch_get_memory_size(int width, int height, u32 games_count);
+bool sim_batch_init(Sim_Batch *batch, Memory_Arena *arena, int width, int height, u32 games_count);
+void sim_batch_reset_game(Sim_Batch *batch, u32 game, u64 seed);
+void sim_batch_step(Sim_Batch *batch, const u8 *inputs, u8 *events);
+void sim_batch_get_game(Sim_Batch *batch, u32 game, Sim_State *state);
+void sim_batch_set_game(Sim_Batch *batch, u32 game, Sim_State *state);
+u32 sim_batch_pick_kernel();
+bool sim_batch_kernel_supported(u32 kernel);
+const char *sim_batch_get_kernel_name(u32 kernel);
+
+#endif /*SNAKE_SIM_BATCH_H*/
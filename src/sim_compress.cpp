@@ -0,0 +1,231 @@
+// malloc(), realloc(), free()
+#include <stdlib.h>
+// memset(), memcpy()
+#include <string.h>
+
+#include <tracy/zstd/zstd.h>
+#include <tracy/zstd/zdict.h>
+
+#include "sim_compress.h"
+
+//
+// --- Compressing ---
+//
+
+// With 'dictionary' NULL compresses without one. Returns false if zstd
+// couldn't allocate or the dictionary isn't one.
+bool sim_init_compressor(Sim_Compressor *compressor, int level, const void *dictionary, u64 dictionary_size) {
+    ZoneScoped;
+
+    memset(compressor, 0, sizeof(Sim_Compressor));
+    ZSTD_CCtx *context = ZSTD_createCCtx();
+    if (!context) {
+        return false;
+    }
+    compressor->context = context;
+    ZSTD_CCtx_setParameter(context, ZSTD_c_compressionLevel, level);
+    // A single-game replay is under a hundred bytes compressed, the 4-byte
+    // checksum and dictionary id would be a tenth of it. Replays are checked
+    // by playing them and saves have a checksum of their own.
+    ZSTD_CCtx_setParameter(context, ZSTD_c_checksumFlag, 0);
+    ZSTD_CCtx_setParameter(context, ZSTD_c_dictIDFlag, 0);
+
+    if (dictionary) {
+        ZSTD_CDict *prepared = ZSTD_createCDict(dictionary, (size_t)dictionary_size, level);
+        if (!prepared || ZSTD_isError(ZSTD_CCtx_refCDict(context, prepared))) {
+            ZSTD_freeCDict(prepared);
+            sim_free_compressor(compressor);
+            return false;
+        }
+        compressor->dictionary = prepared;
+    }
+    return true;
+}
+
+void sim_free_compressor(Sim_Compressor *compressor) {
+    ZSTD_freeCCtx((ZSTD_CCtx *)compressor->context);
+    ZSTD_freeCDict((ZSTD_CDict *)compressor->dictionary);
+    free(compressor->stream_out);
+    memset(compressor, 0, sizeof(Sim_Compressor));
+}
+
+// Most 'sim_compress()' can take for 'size' bytes.
+u64 sim_get_compressed_size_max(u64 size) {
+    return ZSTD_compressBound((size_t)size);
+}
+
+// Compresses 'size' bytes into one frame. Returns the compressed size, 0 if
+// it didn't fit in 'capacity'.
+u64 sim_compress(Sim_Compressor *compressor, void *to, u64 capacity, const void *from, u64 size) {
+    ZoneScoped;
+
+    size_t written = ZSTD_compress2((ZSTD_CCtx *)compressor->context, to, (size_t)capacity, from, (size_t)size);
+    return ZSTD_isError(written) ? 0 : written;
+}
+
+// Streams 'size' more bytes of one frame into 'file', for data that comes
+// in pieces. zstd holds on to some of it until the next call, 'last' ends
+// the frame and writes out everything. Returns false on errors.
+bool sim_compress_to_file(Sim_Compressor *compressor, FILE *file, const void *data, u64 size, bool last) {
+    ZoneScoped;
+
+    if (!compressor->stream_out) {
+        compressor->stream_out_size = ZSTD_CStreamOutSize();
+        compressor->stream_out = (u8 *) malloc((size_t)compressor->stream_out_size);
+        if (!compressor->stream_out) {
+            return false;
+        }
+    }
+
+    ZSTD_inBuffer in = { data, (size_t)size, 0 };
+    ZSTD_EndDirective directive = last ? ZSTD_e_end : ZSTD_e_continue;
+    while (true) {
+        ZSTD_outBuffer out = { compressor->stream_out, (size_t)compressor->stream_out_size, 0 };
+        size_t left = ZSTD_compressStream2((ZSTD_CCtx *)compressor->context, &out, &in, directive);
+        if (ZSTD_isError(left) || fwrite(out.dst, 1, out.pos, file) != out.pos) {
+            return false;
+        }
+        // Input is all taken once it's been read through, the end also needs zstd's buffers emptied.
+        bool done = last ? (left == 0) : (in.pos == in.size);
+        if (done) {
+            return true;
+        }
+    }
+}
+
+// Whether 'data' starts like a zstd frame.
+bool sim_is_compressed(const void *data, u64 size) {
+    u32 magic;
+    if (size < sizeof(magic)) {
+        return false;
+    }
+    memcpy(&magic, data, sizeof(magic));
+    return magic == ZSTD_MAGICNUMBER;
+}
+
+//
+// --- Decompressing ---
+//
+bool sim_init_decompressor(Sim_Decompressor *decompressor, const void *dictionary, u64 dictionary_size) {
+    ZoneScoped;
+
+    memset(decompressor, 0, sizeof(Sim_Decompressor));
+    ZSTD_DCtx *context = ZSTD_createDCtx();
+    if (!context) {
+        return false;
+    }
+    decompressor->context = context;
+
+    if (dictionary) {
+        ZSTD_DDict *prepared = ZSTD_createDDict(dictionary, (size_t)dictionary_size);
+        if (!prepared || ZSTD_isError(ZSTD_DCtx_refDDict(context, prepared))) {
+            ZSTD_freeDDict(prepared);
+            sim_free_decompressor(decompressor);
+            return false;
+        }
+        decompressor->dictionary = prepared;
+    }
+    return true;
+}
+
+void sim_free_decompressor(Sim_Decompressor *decompressor) {
+    ZSTD_freeDCtx((ZSTD_DCtx *)decompressor->context);
+    ZSTD_freeDDict((ZSTD_DDict *)decompressor->dictionary);
+    memset(decompressor, 0, sizeof(Sim_Decompressor));
+}
+
+// Decompresses into a buffer of known size. Returns the decompressed size,
+// 0 if the data is damaged, needs another dictionary or doesn't fit.
+u64 sim_decompress(Sim_Decompressor *decompressor, void *to, u64 capacity, const void *from, u64 size) {
+    ZoneScoped;
+
+    size_t written = ZSTD_decompressDCtx((ZSTD_DCtx *)decompressor->context, to, (size_t)capacity, from, (size_t)size);
+    return ZSTD_isError(written) ? 0 : written;
+}
+
+// Decompresses into a buffer it allocates, free() it when done. Frames
+// written by 'sim_compress_to_file()' don't say how big they are, so those
+// grow the buffer as they go, and when one is cut short, say by a crash
+// while recording, what's there comes out like a file cut short would.
+// Returns NULL if the data is damaged or needs another dictionary.
+u8 *sim_decompress_all(Sim_Decompressor *decompressor, const void *data, u64 size, u64 *decompressed_size) {
+    ZoneScoped;
+
+    ZSTD_DCtx *context = (ZSTD_DCtx *)decompressor->context;
+    unsigned long long known_size = ZSTD_getFrameContentSize(data, (size_t)size);
+    if (known_size == ZSTD_CONTENTSIZE_ERROR) {
+        return NULL;
+    }
+    if (known_size != ZSTD_CONTENTSIZE_UNKNOWN) {
+        u8 *result = (u8 *) malloc((size_t)known_size + 1);
+        if (!result) {
+            return NULL;
+        }
+        size_t written = ZSTD_decompressDCtx(context, result, (size_t)known_size, data, (size_t)size);
+        if (ZSTD_isError(written) || written != known_size) {
+            free(result);
+            return NULL;
+        }
+        *decompressed_size = written;
+        return result;
+    }
+
+    ZSTD_DCtx_reset(context, ZSTD_reset_session_only);
+    u64 capacity = (size < 16 * 1024) ? 64 * 1024 : size * 4;
+    u8 *result = (u8 *) malloc((size_t)capacity);
+    ZSTD_inBuffer in = { data, (size_t)size, 0 };
+    ZSTD_outBuffer out = { result, (size_t)capacity, 0 };
+    size_t left = 1;
+    bool cut_short = false;
+    while (result && left != 0) {
+        if (out.pos == out.size) {
+            capacity *= 2;
+            u8 *grown = (u8 *) realloc(result, (size_t)capacity);
+            if (!grown) {
+                break;
+            }
+            result = grown;
+            out.dst = result;
+            out.size = (size_t)capacity;
+        }
+        size_t in_before = in.pos;
+        size_t out_before = out.pos;
+        left = ZSTD_decompressStream(context, &out, &in);
+        if (ZSTD_isError(left)) {
+            break;
+        }
+        if (in.pos == in_before && out.pos == out_before && left != 0) {
+            cut_short = true;
+            break;
+        }
+    }
+    if (!result || (left != 0 && !cut_short)) {
+        free(result);
+        return NULL;
+    }
+    *decompressed_size = out.pos;
+    return result;
+}
+
+//
+// --- Dictionaries ---
+//
+
+// Trains a dictionary on 'samples_count' samples laid out back to back in
+// 'samples'. Wants a few hundred samples at least, a hundred times the
+// dictionary size in total does best. Returns the dictionary size, 0 when
+// there's too little to train on.
+u64 sim_train_dictionary(void *dictionary, u64 capacity, const void *samples, const u64 *sample_sizes, u32 samples_count) {
+    ZoneScoped;
+
+    size_t *sizes = (size_t *) malloc(samples_count * sizeof(size_t));
+    if (!sizes) {
+        return 0;
+    }
+    for (u32 sample = 0; sample < samples_count; sample++) {
+        sizes[sample] = (size_t)sample_sizes[sample];
+    }
+    size_t size = ZDICT_trainFromBuffer(dictionary, (size_t)capacity, samples, sizes, samples_count);
+    free(sizes);
+    return ZDICT_isError(size) ? 0 : size;
+}
@@ -0,0 +1,60 @@
+#ifndef SNAKE_SIM_COMPRESS_H
+#define SNAKE_SIM_COMPRESS_H
+
+// Zstandard compression for replays and saves, using the zstd that comes
+// with Tracy.
+//
+// A compressed file is the whole uncompressed file as one zstd frame, so
+// anything reading it decompresses first and then reads it as before.
+// Single-game replays are a few hundred bytes, too little for zstd to learn
+// anything from. A dictionary trained on many of them ('sim_train_dictionary()')
+// gives it that upfront. Files compressed with one only decompress with the
+// same one, and frames don't say which one that is.
+
+// FILE
+#include <stdio.h>
+
+#include "sim.h"
+
+//
+// --- Constants ---
+//
+const int SIM_COMPRESSION_LEVEL_DEFAULT = 3;
+const u64 SIM_DICTIONARY_SIZE_DEFAULT = 4 * 1024; // Bigger ones don't do any better on replays.
+
+//
+// --- Structs ---
+//
+struct Sim_Compressor;
+struct Sim_Decompressor;
+
+// Contexts are reused from call to call, one per thread using them.
+struct Sim_Compressor {
+    void *context;    // ZSTD_CCtx
+    void *dictionary; // ZSTD_CDict, NULL without one.
+    u8 *stream_out;   // For 'sim_compress_to_file()'.
+    u64 stream_out_size;
+};
+
+struct Sim_Decompressor {
+    void *context;    // ZSTD_DCtx
+    void *dictionary; // ZSTD_DDict, NULL without one.
+};
+
+//
+// --- Functions ---
+//
+bool sim_init_compressor(Sim_Compressor *compressor, int level, const void *dictionary, u64 dictionary_size);
+void sim_free_compressor(Sim_Compressor *compressor);
+bool sim_init_decompressor(Sim_Decompressor *decompressor, const void *dictionary, u64 dictionary_size);
+void sim_free_decompressor(Sim_Decompressor *decompressor);
+
+u64 sim_get_compressed_size_max(u64 size);
+u64 sim_compress(Sim_Compressor *compressor, void *to, u64 capacity, const void *from, u64 size);
+bool sim_compress_to_file(Sim_Compressor *compressor, FILE *file, const void *data, u64 size, bool last);
+bool sim_is_compressed(const void *data, u64 size);
+u64 sim_decompress(Sim_Decompressor *decompressor, void *to, u64 capacity, const void *from, u64 size);
+u8 *sim_decompress_all(Sim_Decompressor *decompressor, const void *data, u64 size, u64 *decompressed_size);
+u64 sim_train_dictionary(void *dictionary, u64 capacity, const void *samples, const u64 *sample_sizes, u32 samples_count);
+
+#endif /*SNAKE_SIM_COMPRESS_H*/
@@ -0,0 +1,145 @@
+// assert()
+#include <assert.h>
+// memset(), memcpy()
+#include <string.h>
+
+#include "sim_history.h"
+
+static Sim_State *get_keyframe_state(Sim_History *history, u32 slot) {
+    return (Sim_State *)(history->keyframe_states + (u64)slot * history->state_size);
+}
+
+// Ring slot of the n-th keyframe, 0 is the oldest.
+static u32 get_keyframe_slot(Sim_History *history, u32 n) {
+    return (history->keyframes_first + n) % history->keyframes_capacity;
+}
+
+static u64 get_newest_keyframe_frame(Sim_History *history) {
+    return history->keyframe_frames[get_keyframe_slot(history, history->keyframes_count - 1)];
+}
+
+// Recording after a seek back starts a new future, the old one is dropped.
+static void drop_frames_after_current(Sim_History *history) {
+    if (history->current_frame == history->last_frame) {
+        return;
+    }
+    while (history->keyframes_count > 0 && get_newest_keyframe_frame(history) > history->current_frame) {
+        history->keyframes_count--;
+    }
+    history->last_frame = history->current_frame;
+}
+
+// A keyframe at the same frame as the newest one replaces it, so edits
+// between two ticks don't use up the ring. Oldest one goes when it's full.
+static void push_keyframe(Sim_History *history, Sim_State *state, u64 frame) {
+    assert(state->size == history->state_size);
+
+    u32 slot;
+    if (history->keyframes_count > 0 && get_newest_keyframe_frame(history) == frame) {
+        slot = get_keyframe_slot(history, history->keyframes_count - 1);
+    } else {
+        if (history->keyframes_count == history->keyframes_capacity) {
+            history->keyframes_first = get_keyframe_slot(history, 1);
+            history->keyframes_count--;
+        }
+        slot = get_keyframe_slot(history, history->keyframes_count);
+        history->keyframes_count++;
+    }
+
+    // Slots that were never written aren't states yet, so this can't be 'sim_copy_state()'.
+    memcpy(get_keyframe_state(history, slot), state, history->state_size);
+    history->keyframe_frames[slot] = frame;
+    history->first_frame = history->keyframe_frames[history->keyframes_first];
+}
+
+u64 sim_history_get_memory_size(int width, int height, u32 keyframes_capacity, u32 keyframe_interval) {
+    u64 keyframes = keyframes_capacity;
+    u64 size = 0;
+    size += keyframes * sim_get_state_size(width, height) + 63;
+    size += keyframes * sizeof(u64) + 63;
+    size += keyframes * keyframe_interval * sizeof(u8) + 63;
+    return size;
+}
+
+// Takes storage for 'keyframes_capacity' keyframes and their inputs from
+// 'arena'. With 0 keyframes the history stays off and records nothing.
+// Nothing can be seeked to until the first 'sim_history_record_change()'.
+// Returns false if the arena is too small, in which case 'history' must not be used.
+bool sim_history_init(Sim_History *history, Memory_Arena *arena, int width, int height, u32 keyframes_capacity, u32 keyframe_interval) {
+    ZoneScoped;
+
+    assert(keyframe_interval > 0);
+
+    memset(history, 0, sizeof(Sim_History));
+    if (keyframes_capacity == 0) {
+        return true;
+    }
+
+    history->state_size = sim_get_state_size(width, height);
+    history->keyframe_interval = keyframe_interval;
+    history->keyframes_capacity = keyframes_capacity;
+    history->inputs_capacity = keyframes_capacity * keyframe_interval;
+    history->keyframe_states = (u8 *) push_memory_arena(arena, keyframes_capacity * history->state_size);
+    history->keyframe_frames = (u64 *) push_memory_arena(arena, keyframes_capacity * sizeof(u64));
+    history->inputs = (u8 *) push_memory_arena(arena, history->inputs_capacity * sizeof(u8));
+
+    return history->keyframe_states && history->keyframe_frames && history->inputs;
+}
+
+// After every 'sim_step()', with the state it left and the input it got.
+void sim_history_record_tick(Sim_History *history, Sim_State *state, Sim_Input input) {
+    if (history->keyframes_capacity == 0) {
+        return;
+    }
+
+    drop_frames_after_current(history);
+    history->inputs[history->current_frame % history->inputs_capacity] = (u8)input;
+    history->current_frame++;
+    history->last_frame = history->current_frame;
+
+    if (history->keyframes_count == 0 ||
+        history->current_frame - get_newest_keyframe_frame(history) >= history->keyframe_interval) {
+        push_keyframe(history, state, history->current_frame);
+    }
+}
+
+// After anything but 'sim_step()' changed the state.
+void sim_history_record_change(Sim_History *history, Sim_State *state) {
+    if (history->keyframes_capacity == 0) {
+        return;
+    }
+
+    drop_frames_after_current(history);
+    push_keyframe(history, state, history->current_frame);
+}
+
+// Puts 'state' at 'frame', clamped to what the history still has. Recorded
+// frames past it stay until the next record, so seeking forward again works.
+// Returns false when there's nothing recorded yet.
+bool sim_history_seek(Sim_History *history, Sim_State *state, u64 frame) {
+    ZoneScoped;
+
+    if (history->keyframes_count == 0) {
+        return false;
+    }
+    frame = glm::clamp(frame, history->first_frame, history->last_frame);
+
+    u32 n = history->keyframes_count - 1;
+    while (history->keyframe_frames[get_keyframe_slot(history, n)] > frame) {
+        n--;
+    }
+    u32 slot = get_keyframe_slot(history, n);
+    sim_copy_state(state, get_keyframe_state(history, slot));
+
+    for (u64 replayed = history->keyframe_frames[slot]; replayed < frame; replayed++) {
+        sim_step(state, (Sim_Input)history->inputs[replayed % history->inputs_capacity]);
+    }
+    history->current_frame = frame;
+    return true;
+}
+
+// Bytes taken by keyframes and inputs recorded so far.
+u64 sim_history_get_memory_used(Sim_History *history) {
+    u64 inputs = glm::min(history->last_frame - history->first_frame, (u64)history->inputs_capacity);
+    return history->keyframes_count * history->state_size + inputs * sizeof(u8);
+}
@@ -0,0 +1,56 @@
+#ifndef SNAKE_SIM_HISTORY_H
+#define SNAKE_SIM_HISTORY_H
+
+// Bounded history of one game that can be scrubbed back and forth.
+//
+// Every tick's input goes into a ring, and every 'keyframe_interval' ticks
+// the whole state is copied with 'sim_copy_state()' into a ring of keyframes.
+// Changes that don't come from a tick (new game, edits) take a keyframe right
+// away, so inputs alone replay everything between two keyframes. Going to any
+// frame still in the history restores the keyframe before it and replays at
+// most one interval of ticks, so a seek costs about the same anywhere.
+//
+// Frame 'n' is the state after the 'n'th recorded tick. Frames only count up,
+// across game resets too, so they aren't the same as 'Sim_State::tick'.
+
+#include "sim.h"
+
+//
+// --- Structs ---
+//
+struct Sim_History;
+
+struct Sim_History {
+    u64 state_size; // Bytes of one keyframe, same as the state's 'size'.
+    u32 keyframe_interval;
+    u32 keyframes_capacity; // 0 when the history is off.
+
+    // Ring of keyframes, oldest at 'keyframes_first'. Blocks are 'state_size'
+    // apart, 'keyframe_frames' has the frame each of them was taken at.
+    u8 *keyframe_states;
+    u64 *keyframe_frames;
+    u32 keyframes_first;
+    u32 keyframes_count;
+
+    // Input of the tick that led to frame 'n + 1' is at 'n % inputs_capacity'.
+    // Keyframes are at most one interval apart, so 'keyframes_capacity'
+    // intervals of inputs cover everything from the oldest one on.
+    u8 *inputs;
+    u32 inputs_capacity;
+
+    u64 first_frame;   // Oldest frame a seek can go to, the oldest keyframe's.
+    u64 last_frame;    // Newest recorded frame.
+    u64 current_frame; // Frame the game is at, below 'last_frame' after seeking back.
+};
+
+//
+// --- Functions ---
+//
+u64 sim_history_get_memory_size(int width, int height, u32 keyframes_capacity, u32 keyframe_interval);
+bool sim_history_init(Sim_History *history, Memory_Arena *arena, int width, int height, u32 keyframes_capacity, u32 keyframe_interval);
+void sim_history_record_tick(Sim_History *history, Sim_State *state, Sim_Input input);
+void sim_history_record_change(Sim_History *history, Sim_State *state);
+bool sim_history_seek(Sim_History *history, Sim_State *state, u64 frame);
+u64 sim_history_get_memory_used(Sim_History *history);
+
+#endif /*SNAKE_SIM_HISTORY_H*/
@@ -0,0 +1,912 @@
+// assert()
+#include <assert.h>
+// malloc(), realloc(), free()
+#include <stdlib.h>
+// memset(), memcpy()
+#include <string.h>
+// placement new
+#include <new>
+#include <chrono>
+
+#include "sim_replay.h"
+#include "sim_save.h"
+
+//
+// --- Writing ---
+//
+
+// Hands the block to the writer thread. Waits in the rare case it's
+// SIM_REPLAY_BLOCKS_QUEUED blocks behind, a replay with a hole is no replay.
+static void submit_block(Sim_Replay_Writer *writer) {
+    ZoneScoped;
+
+    if (writer->block.size == 0) {
+        return;
+    }
+    while (!spsc_push(writer->queue, writer->block)) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    writer->block.size = 0;
+}
+
+static inline void put_byte(Sim_Replay_Writer *writer, u8 byte) {
+    if (writer->block.size == SIM_REPLAY_BLOCK_SIZE) {
+        submit_block(writer);
+    }
+    writer->block.bytes[writer->block.size++] = byte;
+    writer->bytes++;
+}
+
+static void put_varint(Sim_Replay_Writer *writer, u64 value) {
+    while (value >= 0x80) {
+        put_byte(writer, (u8)(value | 0x80));
+        value >>= 7;
+    }
+    put_byte(writer, (u8)value);
+}
+
+static void put_u64(Sim_Replay_Writer *writer, u64 value) {
+    For (8) {
+        put_byte(writer, (u8)(value >> (it * 8)));
+    }
+}
+
+static void put_u32(Sim_Replay_Writer *writer, u32 value) {
+    For (4) {
+        put_byte(writer, (u8)(value >> (it * 8)));
+    }
+}
+
+static void put_bytes(Sim_Replay_Writer *writer, const void *data, u64 size) {
+    const u8 *bytes = (const u8 *)data;
+    while (size > 0) {
+        if (writer->block.size == SIM_REPLAY_BLOCK_SIZE) {
+            submit_block(writer);
+        }
+        u64 part = SIM_REPLAY_BLOCK_SIZE - writer->block.size;
+        part = (part < size) ? part : size;
+        memcpy(writer->block.bytes + writer->block.size, bytes, (size_t)part);
+        writer->block.size += (u32)part;
+        writer->bytes += part;
+        bytes += part;
+        size -= part;
+    }
+}
+
+// Makes room for one more item in a malloc()'d array, doubling it. Returns
+// false when out of memory, the array is left as it was.
+static bool reserve_item(void **items, u32 *capacity, u32 count, size_t item_size) {
+    if (count < *capacity) {
+        return true;
+    }
+    u32 grown_capacity = *capacity ? *capacity * 2 : 64;
+    void *grown = (grown_capacity > *capacity) ? realloc(*items, grown_capacity * item_size) : NULL;
+    if (!grown) {
+        return false;
+    }
+    *items = grown;
+    *capacity = grown_capacity;
+    return true;
+}
+
+static bool is_direction(Sim_Input input) {
+    return input >= SIM_INPUT_UP && input <= SIM_INPUT_RIGHT;
+}
+
+static void write_group(Sim_Replay_Writer *writer) {
+    if (writer->group_count == 0) {
+        return;
+    }
+    put_varint(writer, ((u64)(writer->group_count - 1) << 2) | SIM_REPLAY_TAG_GROUP);
+    For ((int)((writer->group_count + 3) / 4)) {
+        put_byte(writer, writer->group[it]);
+    }
+    writer->group_count = 0;
+    memset(writer->group, 0, sizeof(writer->group));
+}
+
+// Moves the run of 'run_input' into the stream: into the group when it's short,
+// as a run of its own otherwise. Group goes first, its directions came first.
+void sim_replay_close_run(Sim_Replay_Writer *writer) {
+    u32 length = writer->run_length;
+    writer->run_length = 0;
+    if (length == 0) {
+        return;
+    }
+
+    Sim_Input input = writer->run_input;
+    if (!is_direction(input)) {
+        write_group(writer);
+        For ((int)length) {
+            put_varint(writer, ((u64)input << 2) | SIM_REPLAY_TAG_INPUT);
+        }
+        return;
+    }
+
+    u32 direction = (u32)(input - SIM_INPUT_UP);
+    if (length >= SIM_REPLAY_RUN_MIN) {
+        write_group(writer);
+        put_varint(writer, ((u64)(length - 1) << 4) | (direction << 2) | SIM_REPLAY_TAG_RUN);
+        return;
+    }
+    For ((int)length) {
+        writer->group[writer->group_count >> 2] |= (u8)(direction << ((writer->group_count & 3) * 2));
+        writer->group_count++;
+        if (writer->group_count == SIM_REPLAY_GROUP_MAX) {
+            write_group(writer);
+        }
+    }
+}
+
+static void put_control(Sim_Replay_Writer *writer, u32 code) {
+    put_varint(writer, ((u64)code << 2) | SIM_REPLAY_TAG_CONTROL);
+}
+
+// KEYFRAME entry of the whole state, 'tick' ticks into the game.
+static void put_state(Sim_Replay_Writer *writer, Sim_State *state, u64 tick) {
+    put_control(writer, SIM_REPLAY_CONTROL_KEYFRAME);
+    put_varint(writer, tick);
+    put_varint(writer, state->size);
+    put_u64(writer, sim_checksum(state, state->size));
+    put_bytes(writer, state, state->size);
+}
+
+// Called by 'sim_replay_record_input()' every keyframe interval. Inputs
+// before it are written out first, so it sits right between two ticks.
+void sim_replay_write_keyframe(Sim_Replay_Writer *writer, Sim_State *state) {
+    ZoneScoped;
+
+    sim_replay_close_run(writer);
+    write_group(writer);
+    writer->next_keyframe += writer->keyframe_interval;
+    if (writer->keyframe_bytes + state->size > SIM_REPLAY_KEYFRAME_BYTES_MAX) {
+        writer->next_keyframe = U64_MAX; // Out of budget, none for the rest of the game.
+        return;
+    }
+    writer->keyframe_bytes += state->size;
+    if (!writer->index_lost && reserve_item((void **)&writer->index_keyframes, &writer->index_keyframes_capacity,
+                                            writer->index_keyframes_count, sizeof(u64))) {
+        writer->index_keyframes[writer->index_keyframes_count++] = writer->bytes;
+        writer->index_games[writer->index_games_count - 1].keyframes_count++;
+    } else {
+        writer->index_lost = true;
+    }
+    put_state(writer, state, writer->ticks - writer->game_first_tick);
+}
+
+// Writes out the game's last inputs, with or without its end after them.
+// Nothing is recorded again until the next game.
+static void finish_game(Sim_Replay_Writer *writer) {
+    sim_replay_close_run(writer);
+    write_group(writer);
+    if (!writer->index_lost) {
+        writer->index_games[writer->index_games_count - 1].ticks = writer->ticks - writer->game_first_tick;
+    }
+    writer->in_game = false;
+    writer->run_input = SIM_INPUT_NONE;
+}
+
+// Footer of every game and keyframe, see sim_replay.h.
+static void write_index(Sim_Replay_Writer *writer) {
+    u64 index_at = writer->bytes;
+    For ((int)writer->index_games_count) {
+        Sim_Replay_Index_Game *game = &writer->index_games[it];
+        put_u64(writer, game->offset);
+        put_u64(writer, game->ticks);
+        put_u64(writer, game->keyframe_interval);
+        put_u32(writer, game->first_keyframe);
+        put_u32(writer, game->keyframes_count);
+    }
+    For ((int)writer->index_keyframes_count) {
+        put_u64(writer, writer->index_keyframes[it]);
+    }
+    put_u64(writer, index_at);
+    put_u32(writer, writer->index_games_count);
+    put_u32(writer, writer->index_keyframes_count);
+    put_u64(writer, SIM_REPLAY_INDEX_MAGIC);
+}
+
+static void run_writer_thread(Sim_Replay_Writer *writer) {
+    Sim_Replay_Block *block = &writer->written;
+    while (true) {
+        bool running = writer->running.load(std::memory_order_acquire);
+        bool wrote = false;
+        while (spsc_pop(writer->queue, block)) {
+            if (writer->compressed) {
+                sim_compress_to_file(&writer->compressor, writer->file, block->bytes, block->size, false);
+            } else {
+                fwrite(block->bytes, 1, block->size, writer->file);
+            }
+            wrote = true;
+        }
+
+        if (!wrote) {
+            // Queue was read after 'running' was, so nothing submitted before 'sim_replay_close()' is left.
+            if (!running) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+    if (writer->compressed) {
+        sim_compress_to_file(&writer->compressor, writer->file, NULL, 0, true);
+    }
+    fflush(writer->file);
+}
+
+// Creates the file and starts the writer thread. 'compression_level' 0
+// writes the stream as it is, 'dictionary' is optional. Returns false if
+// the file can't be created, the writer then records nothing.
+bool sim_replay_open(Sim_Replay_Writer *writer, const char *path, int compression_level, const void *dictionary, u64 dictionary_size) {
+    ZoneScoped;
+
+    assert(!writer->file);
+
+    writer->in_game = false;
+    writer->run_input = SIM_INPUT_NONE;
+    writer->run_length = 0;
+    writer->group_count = 0;
+    memset(writer->group, 0, sizeof(writer->group));
+    writer->block.size = 0;
+    writer->games = 0;
+    writer->ticks = 0;
+    writer->bytes = 0;
+    writer->keyframe_bytes = 0;
+    writer->index_games = NULL;
+    writer->index_games_count = 0;
+    writer->index_games_capacity = 0;
+    writer->index_keyframes = NULL;
+    writer->index_keyframes_count = 0;
+    writer->index_keyframes_capacity = 0;
+    writer->index_lost = false;
+
+    writer->compressed = compression_level > 0;
+    if (writer->compressed && !sim_init_compressor(&writer->compressor, compression_level, dictionary, dictionary_size)) {
+        return false;
+    }
+    void *memory = malloc(sizeof(*writer->queue) + sizeof(void *) + 63);
+    writer->file = memory ? fopen(path, "wb") : NULL;
+    if (!writer->file) {
+        free(memory);
+        if (writer->compressed) {
+            sim_free_compressor(&writer->compressor);
+        }
+        return false;
+    }
+    // Queue indices are cache line aligned, more than malloc() promises. Kept
+    // in front of it so 'sim_replay_close()' can free it.
+    u8 *aligned = (u8 *)(((uintptr_t)memory + sizeof(void *) + 63) & ~(uintptr_t)63);
+    ((void **)aligned)[-1] = memory;
+    writer->queue = new (aligned) Spsc_Queue<Sim_Replay_Block, SIM_REPLAY_BLOCKS_QUEUED>();
+
+    Sim_Replay_File_Header header = {};
+    header.magic = SIM_REPLAY_MAGIC;
+    header.version = SIM_REPLAY_VERSION;
+    header.state_struct_size = sizeof(Sim_State);
+    if (writer->compressed) {
+        sim_compress_to_file(&writer->compressor, writer->file, &header, sizeof(header), false);
+    } else {
+        fwrite(&header, sizeof(header), 1, writer->file);
+    }
+    writer->bytes = sizeof(header);
+
+    writer->running.store(true, std::memory_order_release);
+    writer->thread = std::thread(run_writer_thread, writer);
+    return true;
+}
+
+// Writes out everything recorded and the index, and closes the file. A game
+// still going is left without its end, call 'sim_replay_end_game()' first.
+void sim_replay_close(Sim_Replay_Writer *writer) {
+    ZoneScoped;
+
+    if (!writer->file) {
+        return;
+    }
+    if (writer->in_game) {
+        finish_game(writer);
+    }
+    if (!writer->index_lost) {
+        write_index(writer);
+    }
+    submit_block(writer);
+    writer->running.store(false, std::memory_order_release);
+    writer->thread.join();
+
+    fclose(writer->file);
+    writer->file = NULL;
+    if (writer->compressed) {
+        sim_free_compressor(&writer->compressor);
+    }
+    free(((void **)writer->queue)[-1]);
+    writer->queue = NULL;
+    free(writer->index_games);
+    free(writer->index_keyframes);
+    writer->index_games = NULL;
+    writer->index_keyframes = NULL;
+}
+
+// Right after 'sim_reset()'. The game before it has to be ended first, with
+// 'sim_replay_end_game()' before the reset, its end is the state it left.
+void sim_replay_begin_game(Sim_Replay_Writer *writer, Sim_State *state) {
+    if (!writer->file) {
+        return;
+    }
+    assert(!writer->in_game);
+    if (writer->in_game) {
+        finish_game(writer); // Without an end rather than one from the state after the reset.
+    }
+
+    // Without room for the index games are still recorded, readers then find them by reading the stream.
+    u64 interval = SIM_REPLAY_KEYFRAME_INTERVAL;
+    if (!writer->index_lost && reserve_item((void **)&writer->index_games, &writer->index_games_capacity,
+                                            writer->index_games_count, sizeof(Sim_Replay_Index_Game))) {
+        Sim_Replay_Index_Game *game = &writer->index_games[writer->index_games_count++];
+        game->offset = writer->bytes;
+        game->ticks = 0;
+        game->keyframe_interval = interval;
+        game->first_keyframe = writer->index_keyframes_count;
+        game->keyframes_count = 0;
+    } else {
+        writer->index_lost = true;
+    }
+    writer->game_first_tick = writer->ticks;
+    writer->keyframe_interval = interval;
+    writer->next_keyframe = writer->ticks + interval;
+
+    put_control(writer, SIM_REPLAY_CONTROL_GAME_START);
+    put_u64(writer, state->seed);
+    put_varint(writer, (u64)state->width);
+    put_varint(writer, (u64)state->height);
+    writer->in_game = true;
+    writer->games++;
+}
+
+// Instead of 'sim_replay_begin_game()' when the game goes on from a state
+// ticks didn't get it to: a loaded save, a history seek, a debug edit. The
+// whole state follows its GAME_START, readers start from that instead of the
+// seed, see 'sim_replay_start_game()'.
+void sim_replay_begin_edited_game(Sim_Replay_Writer *writer, Sim_State *state) {
+    ZoneScoped;
+
+    if (!writer->file) {
+        return;
+    }
+    sim_replay_begin_game(writer, state);
+    put_state(writer, state, 0);
+}
+
+// With the state as the last recorded tick left it, so a replay can check it
+// got to the same place. Nothing is recorded again until the next game.
+void sim_replay_end_game(Sim_Replay_Writer *writer, Sim_State *state, u32 reason) {
+    if (!writer->file || !writer->in_game) {
+        return;
+    }
+
+    finish_game(writer);
+    put_control(writer, SIM_REPLAY_CONTROL_GAME_END);
+    put_varint(writer, reason);
+    put_varint(writer, state->tick);
+    put_varint(writer, (u64)(u32)state->score);
+    put_varint(writer, (u64)(u32)state->moves);
+    put_u64(writer, state->hash);
+}
+
+//
+// --- Reading ---
+//
+static bool get_varint(Sim_Replay_Reader *reader, u64 *value) {
+    u64 result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (reader->at == reader->size) {
+            return false;
+        }
+        u8 byte = reader->data[reader->at++];
+        result |= (u64)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static u64 load_u64(const u8 *bytes) {
+    u64 result = 0;
+    For (8) {
+        result |= (u64)bytes[it] << (it * 8);
+    }
+    return result;
+}
+
+static u32 load_u32(const u8 *bytes) {
+    u32 result = 0;
+    For (4) {
+        result |= (u32)bytes[it] << (it * 8);
+    }
+    return result;
+}
+
+static void store_u64(u8 *bytes, u64 value) {
+    For (8) {
+        bytes[it] = (u8)(value >> (it * 8));
+    }
+}
+
+static void store_u32(u8 *bytes, u32 value) {
+    For (4) {
+        bytes[it] = (u8)(value >> (it * 8));
+    }
+}
+
+static bool get_u64(Sim_Replay_Reader *reader, u64 *value) {
+    if (reader->size - reader->at < 8) {
+        return false;
+    }
+    *value = load_u64(reader->data + reader->at);
+    reader->at += 8;
+    return true;
+}
+
+// 'data' has to stay around while the reader is used. Returns false when it
+// isn't a replay this version reads. An index footer that doesn't add up is
+// left as part of the stream, where it reads as malformed.
+bool sim_replay_open_reader(Sim_Replay_Reader *reader, const void *data, u64 size) {
+    reader->data = (const u8 *)data;
+    reader->size = size;
+    reader->at = 0;
+    reader->state_struct_size = 0;
+    reader->index = NULL;
+    reader->index_size = 0;
+
+    Sim_Replay_File_Header header;
+    if (size < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != SIM_REPLAY_MAGIC || header.version < SIM_REPLAY_VERSION_OLDEST || header.version > SIM_REPLAY_VERSION) {
+        return false;
+    }
+    reader->at = sizeof(header);
+    reader->state_struct_size = header.state_struct_size;
+
+    if (size >= sizeof(header) + SIM_REPLAY_INDEX_FOOTER_SIZE) {
+        const u8 *footer = reader->data + size - SIM_REPLAY_INDEX_FOOTER_SIZE;
+        u64 index_at = load_u64(footer);
+        u64 records_size = (u64)load_u32(footer + 8) * SIM_REPLAY_INDEX_GAME_SIZE + (u64)load_u32(footer + 12) * sizeof(u64);
+        // Compared without adding, a crafted footer could wrap the sum around.
+        if (load_u64(footer + 16) == SIM_REPLAY_INDEX_MAGIC && index_at >= sizeof(header) &&
+            index_at <= size - SIM_REPLAY_INDEX_FOOTER_SIZE && records_size == size - SIM_REPLAY_INDEX_FOOTER_SIZE - index_at) {
+            reader->index = reader->data + index_at;
+            reader->index_size = size - index_at;
+            reader->size = index_at;
+        }
+    }
+    return true;
+}
+
+// Next entry of the stream, Sim_Replay_Entry_Kind. Only the fields of that kind are set.
+u32 sim_replay_read(Sim_Replay_Reader *reader, Sim_Replay_Entry *entry) {
+    if (reader->at == reader->size) {
+        entry->kind = SIM_REPLAY_ENTRY_END;
+        return entry->kind;
+    }
+    entry->kind = SIM_REPLAY_ENTRY_ERROR;
+
+    u64 value;
+    if (!get_varint(reader, &value)) {
+        return entry->kind;
+    }
+    switch (value & 3) {
+        case SIM_REPLAY_TAG_GROUP: {
+            u64 count = (value >> 2) + 1;
+            u64 bytes = (count + 3) / 4;
+            if (count > SIM_REPLAY_GROUP_MAX || reader->size - reader->at < bytes) {
+                return entry->kind;
+            }
+            entry->count = (u32)count;
+            entry->packed = reader->data + reader->at;
+            reader->at += bytes;
+            entry->kind = SIM_REPLAY_ENTRY_GROUP;
+        } break;
+        case SIM_REPLAY_TAG_RUN: {
+            u64 count = (value >> 4) + 1;
+            if (count > U32_MAX) {
+                return entry->kind;
+            }
+            entry->input = (Sim_Input)(SIM_INPUT_UP + ((value >> 2) & 3));
+            entry->count = (u32)count;
+            entry->kind = SIM_REPLAY_ENTRY_RUN;
+        } break;
+        case SIM_REPLAY_TAG_INPUT: {
+            if ((value >> 2) > SIM_INPUT_RIGHT) {
+                return entry->kind;
+            }
+            entry->input = (Sim_Input)(value >> 2);
+            entry->count = 1;
+            entry->kind = SIM_REPLAY_ENTRY_RUN;
+        } break;
+        case SIM_REPLAY_TAG_CONTROL: {
+            u64 code = value >> 2;
+            if (code == SIM_REPLAY_CONTROL_GAME_START) {
+                u64 width, height;
+                if (!get_u64(reader, &entry->seed) || !get_varint(reader, &width) || !get_varint(reader, &height) ||
+                    width < SIM_BOARD_SIDE_MIN || width > SIM_BOARD_SIDE_MAX || height < SIM_BOARD_SIDE_MIN || height > SIM_BOARD_SIDE_MAX) {
+                    return entry->kind;
+                }
+                entry->width = (int)width;
+                entry->height = (int)height;
+                entry->kind = SIM_REPLAY_ENTRY_GAME_START;
+            } else if (code == SIM_REPLAY_CONTROL_GAME_END) {
+                u64 reason, tick, score, moves;
+                if (!get_varint(reader, &reason) || !get_varint(reader, &tick) || !get_varint(reader, &score) ||
+                    !get_varint(reader, &moves) || !get_u64(reader, &entry->hash)) {
+                    return entry->kind;
+                }
+                entry->end_reason = (u32)reason;
+                entry->tick = tick;
+                entry->score = (int)(u32)score;
+                entry->moves = (int)(u32)moves;
+                entry->kind = SIM_REPLAY_ENTRY_GAME_END;
+            } else if (code == SIM_REPLAY_CONTROL_KEYFRAME) {
+                u64 tick, state_size;
+                if (!get_varint(reader, &tick) || !get_varint(reader, &state_size) || !get_u64(reader, &entry->checksum) ||
+                    reader->size - reader->at < state_size) {
+                    return entry->kind;
+                }
+                entry->tick = tick;
+                entry->state = reader->data + reader->at;
+                entry->state_size = state_size;
+                reader->at += state_size;
+                entry->kind = SIM_REPLAY_ENTRY_KEYFRAME;
+            }
+        } break;
+    }
+    return entry->kind;
+}
+
+// Skips to the next game and past it, for cutting a replay into games.
+// Its entries are 'data[begin, end)', from its GAME_START to after its
+// GAME_END, or to the last whole entry when the recording stopped early.
+// A file header in front of them makes a replay of that game alone.
+// Returns false when there are no more games.
+bool sim_replay_find_game(Sim_Replay_Reader *reader, u64 *begin, u64 *end) {
+    Sim_Replay_Entry entry;
+    u64 at = reader->at;
+    u32 kind = sim_replay_read(reader, &entry);
+    while (kind > SIM_REPLAY_ENTRY_ERROR && kind != SIM_REPLAY_ENTRY_GAME_START) {
+        at = reader->at;
+        kind = sim_replay_read(reader, &entry);
+    }
+    if (kind != SIM_REPLAY_ENTRY_GAME_START) {
+        return false;
+    }
+
+    *begin = at;
+    *end = reader->at;
+    while (true) {
+        at = reader->at;
+        kind = sim_replay_read(reader, &entry);
+        if (kind <= SIM_REPLAY_ENTRY_ERROR || kind == SIM_REPLAY_ENTRY_GAME_START) {
+            reader->at = at; // Next call starts there.
+            return true;
+        }
+        *end = reader->at;
+        if (kind == SIM_REPLAY_ENTRY_GAME_END) {
+            return true;
+        }
+    }
+}
+
+//
+// --- Playing ---
+//
+
+// Whether a keyframe has the tick and hash 'state' got to by playing.
+static bool keyframe_matches(Sim_Replay_Reader *reader, Sim_Replay_Entry *keyframe, Sim_State *state, u64 tick) {
+    Sim_State recorded;
+    if (keyframe->tick != tick || reader->state_struct_size != sizeof(Sim_State) || keyframe->state_size < sizeof(Sim_State)) {
+        return false;
+    }
+    memcpy(&recorded, keyframe->state, sizeof(Sim_State));
+    return recorded.tick == state->tick && recorded.hash == state->hash;
+}
+
+// Steps 'state' through the inputs that follow, as fast as 'sim_step()'
+// goes, from where 'sim_replay_start_game()' left the reader and the state,
+// and stops at the first entry that isn't one. That entry is left in
+// 'entry' and returned, GAME_END when the game was recorded to its end.
+// Once a tick ends the game the rest of its inputs are only counted.
+// Keyframes are checked against the played state rather than used, see
+// 'sim_replay_seek()' for that.
+u32 sim_replay_play_inputs(Sim_Replay_Reader *reader, Sim_State *state, Sim_Replay_Entry *entry, Sim_Replay_Playback *playback) {
+    ZoneScoped;
+
+    memset(playback, 0, sizeof(Sim_Replay_Playback));
+    bool over = false;
+    while (true) {
+        u32 kind = sim_replay_read(reader, entry);
+        if (kind == SIM_REPLAY_ENTRY_KEYFRAME) {
+            playback->keyframes++;
+            playback->keyframes_differ += !keyframe_matches(reader, entry, state, playback->ticks + playback->ignored);
+            continue;
+        }
+        if (kind != SIM_REPLAY_ENTRY_RUN && kind != SIM_REPLAY_ENTRY_GROUP) {
+            return kind;
+        }
+
+        u32 at = 0;
+        for (; at < entry->count && !over; at++) {
+            Sim_Input input = (kind == SIM_REPLAY_ENTRY_RUN) ? entry->input : sim_replay_get_packed_input(entry->packed, at);
+            playback->events = sim_step(state, input);
+            over = (playback->events & (SIM_EVENT_DIED | SIM_EVENT_WON)) != 0;
+        }
+        playback->ticks += at;
+        playback->ignored += entry->count - at;
+    }
+}
+
+//
+// --- Seeking ---
+//
+
+// Reads the whole stream for what the footer would have said. Games are
+// assumed to keep the keyframe spacing of their first keyframe, seeking
+// checks that anyway.
+static bool build_index(Sim_Replay_Index *index, Sim_Replay_Reader *from) {
+    ZoneScoped;
+
+    Sim_Replay_Reader reader = *from;
+    reader.at = sizeof(Sim_Replay_File_Header);
+    Sim_Replay_Index_Game *games = NULL;
+    u64 *keyframes = NULL;
+    u32 games_capacity = 0;
+    u32 keyframes_capacity = 0;
+    bool enough_memory = true;
+
+    Sim_Replay_Entry entry;
+    Sim_Replay_Index_Game *game = NULL;
+    u64 at = reader.at;
+    u32 kind;
+    while ((kind = sim_replay_read(&reader, &entry)) > SIM_REPLAY_ENTRY_ERROR) {
+        if (kind == SIM_REPLAY_ENTRY_GAME_START) {
+            enough_memory = reserve_item((void **)&games, &games_capacity, index->games_count, sizeof(Sim_Replay_Index_Game));
+            if (!enough_memory) {
+                break;
+            }
+            game = &games[index->games_count++];
+            memset(game, 0, sizeof(Sim_Replay_Index_Game));
+            game->offset = at;
+            game->first_keyframe = index->keyframes_count;
+        } else if (game && (kind == SIM_REPLAY_ENTRY_RUN || kind == SIM_REPLAY_ENTRY_GROUP)) {
+            game->ticks += entry.count;
+        } else if (game && kind == SIM_REPLAY_ENTRY_KEYFRAME && entry.tick > 0) { // Tick 0 is the state an edited game starts from.
+            enough_memory = reserve_item((void **)&keyframes, &keyframes_capacity, index->keyframes_count, sizeof(u64));
+            if (!enough_memory) {
+                break;
+            }
+            keyframes[index->keyframes_count++] = at;
+            if (game->keyframes_count++ == 0) {
+                game->keyframe_interval = entry.tick;
+            }
+        } else if (kind == SIM_REPLAY_ENTRY_GAME_END) {
+            game = NULL;
+        }
+        at = reader.at;
+    }
+
+    u64 games_size = (u64)index->games_count * SIM_REPLAY_INDEX_GAME_SIZE;
+    index->built = enough_memory ? (u8 *) malloc((size_t)(games_size + index->keyframes_count * sizeof(u64) + 1)) : NULL;
+    if (index->built) {
+        For ((int)index->games_count) {
+            u8 *record = index->built + it * SIM_REPLAY_INDEX_GAME_SIZE;
+            store_u64(record, games[it].offset);
+            store_u64(record + 8, games[it].ticks);
+            store_u64(record + 16, games[it].keyframe_interval);
+            store_u32(record + 24, games[it].first_keyframe);
+            store_u32(record + 28, games[it].keyframes_count);
+        }
+        For ((int)index->keyframes_count) {
+            store_u64(index->built + games_size + it * sizeof(u64), keyframes[it]);
+        }
+        index->games = index->built;
+        index->keyframes = index->built + games_size;
+    }
+    free(games);
+    free(keyframes);
+    return index->built != NULL;
+}
+
+// Index of every game and keyframe. Takes the file's footer as it is when
+// there is one, otherwise reads through the stream for it, which a recording
+// that didn't get closed needs. The reader's data has to stay around while
+// the index is used. Returns false when out of memory.
+bool sim_replay_load_index(Sim_Replay_Index *index, Sim_Replay_Reader *reader) {
+    memset(index, 0, sizeof(Sim_Replay_Index));
+    if (!reader->index) {
+        return build_index(index, reader);
+    }
+    const u8 *footer = reader->index + reader->index_size - SIM_REPLAY_INDEX_FOOTER_SIZE;
+    index->games_count = load_u32(footer + 8);
+    index->keyframes_count = load_u32(footer + 12);
+    index->games = reader->index;
+    index->keyframes = reader->index + (u64)index->games_count * SIM_REPLAY_INDEX_GAME_SIZE;
+    return true;
+}
+
+void sim_replay_free_index(Sim_Replay_Index *index) {
+    free(index->built);
+    memset(index, 0, sizeof(Sim_Replay_Index));
+}
+
+// Game 'game' of the replay, from 0. Returns false past the last one.
+bool sim_replay_get_index_game(Sim_Replay_Index *index, u32 game, Sim_Replay_Index_Game *result) {
+    if (game >= index->games_count) {
+        return false;
+    }
+    const u8 *record = index->games + (u64)game * SIM_REPLAY_INDEX_GAME_SIZE;
+    result->offset = load_u64(record);
+    result->ticks = load_u64(record + 8);
+    result->keyframe_interval = load_u64(record + 16);
+    result->first_keyframe = load_u32(record + 24);
+    result->keyframes_count = load_u32(record + 28);
+    return true;
+}
+
+// Seed and board of a game, to make a state for 'sim_replay_seek()'.
+// Returns false past the last game or when the index points at anything but
+// a game's start.
+bool sim_replay_get_game_start(Sim_Replay_Reader *reader, Sim_Replay_Index *index, u32 game, Sim_Replay_Entry *start) {
+    Sim_Replay_Index_Game indexed;
+    if (!sim_replay_get_index_game(index, game, &indexed) || indexed.offset >= reader->size) {
+        return false;
+    }
+    Sim_Replay_Reader at_game = *reader;
+    at_game.at = indexed.offset;
+    return sim_replay_read(&at_game, start) == SIM_REPLAY_ENTRY_GAME_START;
+}
+
+// Copies a KEYFRAME entry's state into 'state' if it's a valid state for
+// its board, recorded by a build with the same 'Sim_State'. 'state' is left
+// as it was otherwise.
+static bool restore_state(Sim_Replay_Reader *reader, Sim_Replay_Entry *entry, Sim_State *state) {
+    if (reader->state_struct_size != sizeof(Sim_State) || entry->state_size != state->size) {
+        return false;
+    }
+
+    // Checked apart first, 'state' has to stay usable for playing from the start.
+    // Arrays aren't checked by 'sim_check_state()', a damaged one would have
+    // 'sim_step()' write anywhere.
+    Sim_State recorded;
+    memcpy(&recorded, entry->state, sizeof(Sim_State));
+    if (!sim_check_state(&recorded, entry->state_size) || recorded.width != state->width || recorded.height != state->height ||
+        sim_checksum(entry->state, entry->state_size) != entry->checksum) {
+        return false;
+    }
+    memcpy(state, entry->state, (size_t)entry->state_size);
+    state->kernel = sim_pick_kernel(state->width, state->height); // Kernels are picked per build.
+    return true;
+}
+
+// Copies keyframe 'keyframe' of the index into 'state' if it's a valid
+// state for its board at or before 'tick', and leaves 'cursor' after it.
+static bool restore_keyframe(Sim_Replay_Cursor *cursor, Sim_Replay_Index *index, u32 keyframe, u64 tick, Sim_State *state) {
+    Sim_Replay_Reader *reader = &cursor->reader;
+    if (keyframe >= index->keyframes_count) {
+        return false;
+    }
+    u64 offset = load_u64(index->keyframes + (u64)keyframe * sizeof(u64));
+    if (offset >= reader->size) {
+        return false;
+    }
+    reader->at = offset;
+    Sim_Replay_Entry entry;
+    if (sim_replay_read(reader, &entry) != SIM_REPLAY_ENTRY_KEYFRAME || entry.tick > tick || !restore_state(reader, &entry, state)) {
+        return false;
+    }
+    cursor->tick = entry.tick;
+    return true;
+}
+
+// Puts 'state' where a game begins, with its GAME_START 'start' just read:
+// 'sim_reset()' with its seed, or the state it was recorded from when it
+// went on after an edit, see 'sim_replay_begin_edited_game()'. 'state' has
+// to be made by 'sim_init()' for the game's board. Leaves 'reader' at the
+// game's first input. Returns false when the game starts from a state this
+// build can't use, or a damaged one.
+bool sim_replay_start_game(Sim_Replay_Reader *reader, Sim_Replay_Entry *start, Sim_State *state) {
+    Sim_Replay_Reader after = *reader;
+    Sim_Replay_Entry entry;
+    if (sim_replay_read(&after, &entry) != SIM_REPLAY_ENTRY_KEYFRAME || entry.tick != 0) {
+        sim_reset(state, start->seed);
+        return true;
+    }
+    *reader = after;
+    return restore_state(reader, &entry, state);
+}
+
+// Puts 'state' at 'tick' ticks into game 'game' (from 0), and 'cursor' right
+// after that tick to step on from there. Restores the last keyframe at or
+// before 'tick' and plays only the ticks after it, at most one keyframe
+// interval whatever the tick unless the recording ran out of keyframe budget
+// before it. Without a usable keyframe, or with
+// 'use_keyframes' false, plays from the game's start, see
+// 'sim_replay_start_game()'.
+// 'state' has to be made by 'sim_init()' for the game's board, see
+// 'sim_replay_get_game_start()'. Lands on the game's last tick when it's
+// shorter, 'cursor->tick' says where. Returns false when the index doesn't
+// match the stream, the board isn't the game's or the game can't be started.
+bool sim_replay_seek(Sim_Replay_Cursor *cursor, Sim_Replay_Reader *reader, Sim_Replay_Index *index, u32 game, u64 tick,
+                     Sim_State *state, bool use_keyframes) {
+    ZoneScoped;
+
+    Sim_Replay_Index_Game indexed;
+    Sim_Replay_Entry start;
+    if (!sim_replay_get_game_start(reader, index, game, &start) || start.width != state->width || start.height != state->height) {
+        return false;
+    }
+    sim_replay_get_index_game(index, game, &indexed);
+
+    memset(cursor, 0, sizeof(Sim_Replay_Cursor));
+    cursor->reader = *reader;
+    u64 keyframe = 0;
+    if (use_keyframes && indexed.keyframe_interval > 0) {
+        keyframe = tick / indexed.keyframe_interval;
+        keyframe = (keyframe < indexed.keyframes_count) ? keyframe : indexed.keyframes_count;
+    }
+    if (keyframe == 0 || !restore_keyframe(cursor, index, indexed.first_keyframe + (u32)(keyframe - 1), tick, state)) {
+        cursor->reader.at = indexed.offset;
+        sim_replay_read(&cursor->reader, &start);
+        if (!sim_replay_start_game(&cursor->reader, &start, state)) {
+            return false;
+        }
+        cursor->tick = 0;
+    }
+    sim_replay_step(cursor, state, tick - cursor->tick);
+    return true;
+}
+
+// Steps up to 'ticks' more recorded ticks of the cursor's game. Returns how
+// many it stepped, fewer once the recording or the game is over.
+u64 sim_replay_step(Sim_Replay_Cursor *cursor, Sim_State *state, u64 ticks) {
+    ZoneScoped;
+
+    Sim_Replay_Entry *entry = &cursor->entry;
+    u64 stepped = 0;
+    while (stepped < ticks && !cursor->ended) {
+        if (cursor->entry_at == entry->count) {
+            u32 kind = sim_replay_read(&cursor->reader, entry);
+            cursor->entry_at = 0;
+            if (kind != SIM_REPLAY_ENTRY_RUN && kind != SIM_REPLAY_ENTRY_GROUP) {
+                entry->count = 0;
+                cursor->ended = (kind != SIM_REPLAY_ENTRY_KEYFRAME);
+                continue;
+            }
+        }
+
+        u64 left = ticks - stepped;
+        u32 last = (entry->count - cursor->entry_at < left) ? entry->count : cursor->entry_at + (u32)left;
+        while (cursor->entry_at < last) {
+            Sim_Input input = (entry->kind == SIM_REPLAY_ENTRY_RUN) ? entry->input : sim_replay_get_packed_input(entry->packed, cursor->entry_at);
+            cursor->entry_at++;
+            stepped++;
+            cursor->events = sim_step(state, input);
+            if (cursor->events & (SIM_EVENT_DIED | SIM_EVENT_WON)) {
+                cursor->ended = true;
+                break;
+            }
+        }
+    }
+    cursor->tick += stepped;
+    return stepped;
+}
+
+const char *sim_get_replay_end_reason_name(u32 reason) {
+    switch (reason) {
+        case SIM_REPLAY_END_DIED:      return "died";
+        case SIM_REPLAY_END_WON:       return "won";
+        case SIM_REPLAY_END_ABANDONED: return "abandoned";
+        case SIM_REPLAY_END_EDITED:    return "edited";
+    }
+    return "unknown";
+}
@@ -0,0 +1,299 @@
+#ifndef SNAKE_SIM_REPLAY_H
+#define SNAKE_SIM_REPLAY_H
+
+// Compact replays of whole sessions: every game's seed and board size, then
+// the input of every tick. Rules are deterministic, so that's all it takes to
+// play a game again exactly. A game that gets edited (save loaded, history
+// seek, debug tools) ends there, and goes on as a new game that starts from
+// the edited state instead of a seed.
+//
+// A replay file is a Sim_Replay_File_Header and then a stream of varints,
+// each tagged in its low 2 bits:
+//   SIM_REPLAY_TAG_GROUP    'count - 1' above the tag, then 'count' directions
+//                           packed 2 bits each, 4 to a byte, oldest lowest.
+//   SIM_REPLAY_TAG_RUN      Direction in the next 2 bits, 'count - 1' above it.
+//   SIM_REPLAY_TAG_INPUT    Any other Sim_Input above the tag, for one tick.
+//   SIM_REPLAY_TAG_CONTROL  SIM_REPLAY_CONTROL_ code above the tag, then its fields.
+// Directions are 'Sim_Input - SIM_INPUT_UP'. Turn-based games turn often and
+// end up in groups at about 2 bits a tick. Real-time ones go straight for
+// long stretches, and a stretch is one run: its length in ticks as a varint.
+//
+// Long games also get keyframes: every so many ticks the whole state block
+// goes into the stream, the way 'sim_copy_state()' copies it. Closing the
+// writer appends an index of where every game and keyframe starts, so a
+// reader can go to any tick of any game by restoring the keyframe before it
+// and playing at most SIM_REPLAY_KEYFRAME_INTERVAL ticks of inputs, see
+// 'sim_replay_seek()' and the keyframe budget below. The index is a footer of
+// fixed-size little-endian records, read in place from a mapped file:
+//   games      SIM_REPLAY_INDEX_GAME_SIZE each: offset of its GAME_START
+//              (8 bytes), ticks recorded (8), keyframe interval (8), first
+//              keyframe (4), keyframes (4).
+//   keyframes  Offset of every KEYFRAME entry (8 bytes), by game.
+//   footer     Offset of the index (8), games (4), keyframes (4), SIM_REPLAY_INDEX_MAGIC.
+// Offsets are from the start of the uncompressed file, a compressed replay
+// is decompressed before seeking in it. A recording that didn't get closed
+// has no index, readers then build it from the stream.
+// Keyframes are the in-memory layout, like saves, so seeking only uses them
+// on builds with the same 'Sim_State' size and plays from the start elsewhere.
+//
+// Recording only touches memory on the thread that runs the game. Full
+// blocks go to a writer thread of their own, which does the file writes and
+// the compression when there is any, see sim_compress.h. Readers take the
+// stream uncompressed.
+
+// FILE
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+
+#include "sim.h"
+#include "sim_compress.h"
+#include "spsc_queue.h"
+
+//
+// --- Constants ---
+//
+const u64 SIM_REPLAY_MAGIC = 0x4C5052454B414E53ull; // "SNAKERPL"
+const u32 SIM_REPLAY_VERSION = 3;
+const u32 SIM_REPLAY_VERSION_OLDEST = 2; // Read as well, it only lacks edited games.
+const u64 SIM_REPLAY_INDEX_MAGIC = 0x584449454B414E53ull; // "SNAKEIDX"
+
+const u32 SIM_REPLAY_TAG_GROUP = 0;
+const u32 SIM_REPLAY_TAG_RUN = 1;
+const u32 SIM_REPLAY_TAG_INPUT = 2;
+const u32 SIM_REPLAY_TAG_CONTROL = 3;
+
+// GAME_START: seed (8 bytes), varint width, varint height.
+// GAME_END: varint end reason, varint tick, varint score, varint moves, hash (8 bytes).
+// KEYFRAME: varint ticks into the game, varint state size, 'sim_checksum()' of
+//           the state (8 bytes), the state block. One at tick 0 right after
+//           GAME_START is the state an edited game starts from instead of the seed.
+// Fixed-size fields are little-endian.
+const u32 SIM_REPLAY_CONTROL_GAME_START = 0;
+const u32 SIM_REPLAY_CONTROL_GAME_END = 1;
+const u32 SIM_REPLAY_CONTROL_KEYFRAME = 2;
+
+const u32 SIM_REPLAY_GROUP_MAX = 256; // Directions in one group.
+const u32 SIM_REPLAY_RUN_MIN = 12;    // Shorter runs go into groups, they're smaller there.
+const u32 SIM_REPLAY_BLOCK_SIZE = 4096;
+const u32 SIM_REPLAY_BLOCKS_QUEUED = 16; // Power of two.
+
+// A game gets a keyframe every SIM_REPLAY_KEYFRAME_INTERVAL ticks, whatever
+// its board, so seeking plays at most that many ticks. Big boards have big
+// states, a 4096x4096 one is about 200 MB, so a session writes at most
+// SIM_REPLAY_KEYFRAME_BYTES_MAX of them. Games after that get none, and
+// seeking past a game's last keyframe plays from there.
+const u64 SIM_REPLAY_KEYFRAME_INTERVAL = 65536;
+const u64 SIM_REPLAY_KEYFRAME_BYTES_MAX = 1ull << 30;
+
+const u32 SIM_REPLAY_INDEX_GAME_SIZE = 32;
+const u32 SIM_REPLAY_INDEX_FOOTER_SIZE = 24;
+
+//
+// --- Structs ---
+//
+struct Sim_Replay_File_Header;
+struct Sim_Replay_Block;
+struct Sim_Replay_Writer;
+struct Sim_Replay_Reader;
+struct Sim_Replay_Entry;
+struct Sim_Replay_Playback;
+struct Sim_Replay_Index_Game;
+struct Sim_Replay_Index;
+struct Sim_Replay_Cursor;
+
+struct Sim_Replay_File_Header {
+    u64 magic;
+    u32 version;
+    u32 state_struct_size; // sizeof(Sim_State) of the build that recorded it, for keyframes.
+};
+
+struct Sim_Replay_Block {
+    u32 size;
+    u8 bytes[SIM_REPLAY_BLOCK_SIZE];
+};
+
+// Why a game's recording ended. Only DIED and WON games end where the rules
+// ended them, the others end wherever the player left them.
+enum Sim_Replay_End_Reason {
+    SIM_REPLAY_END_DIED = 0,
+    SIM_REPLAY_END_WON = 1,
+    SIM_REPLAY_END_ABANDONED = 2, // New game started, or the session ended.
+    SIM_REPLAY_END_EDITED = 3,    // State changed other than by a tick, the next game goes on from the changed state.
+};
+
+// One game in the index.
+struct Sim_Replay_Index_Game {
+    u64 offset; // Of its GAME_START entry.
+    u64 ticks;  // Inputs recorded.
+    u64 keyframe_interval; // Keyframe 'n' of the game is 'n + 1' intervals in.
+    u32 first_keyframe;    // Its keyframes in the index.
+    u32 keyframes_count;
+};
+
+// Recording side. Everything but the writer thread belongs to the one thread
+// that runs the game.
+struct Sim_Replay_Writer {
+    FILE *file; // NULL when not recording, every call is a no-op then.
+    std::thread thread;
+    std::atomic<bool> running;
+    Spsc_Queue<Sim_Replay_Block, SIM_REPLAY_BLOCKS_QUEUED> *queue;
+    Sim_Replay_Block block;   // Being filled.
+    Sim_Replay_Block written; // Writer thread only, being written.
+    Sim_Compressor compressor; // Writer thread only, when 'compressed'.
+    bool compressed;
+
+    bool in_game;
+    Sim_Input run_input; // Directions not written yet: the group, then the run after it.
+    u32 run_length;
+    u32 group_count;
+    u8 group[SIM_REPLAY_GROUP_MAX / 4];
+    u64 game_first_tick; // 'ticks' when the game started.
+    u64 keyframe_interval;
+    u64 next_keyframe; // Value of 'ticks' the next keyframe goes after.
+    u64 keyframe_bytes; // State bytes of every keyframe so far, against SIM_REPLAY_KEYFRAME_BYTES_MAX.
+
+    // Index written by 'sim_replay_close()'. Left out if it ran out of memory.
+    Sim_Replay_Index_Game *index_games;
+    u32 index_games_count;
+    u32 index_games_capacity;
+    u64 *index_keyframes;
+    u32 index_keyframes_count;
+    u32 index_keyframes_capacity;
+    bool index_lost;
+
+    u64 games;
+    u64 ticks;
+    u64 bytes; // Everything recorded so far, written or not.
+};
+
+// Reading side, over a whole replay in memory.
+struct Sim_Replay_Reader {
+    const u8 *data;
+    u64 size; // Where the stream ends, the index footer isn't part of it.
+    u64 at;
+    u32 state_struct_size;
+    const u8 *index; // Index records and footer, NULL when the file has none.
+    u64 index_size;
+};
+
+enum Sim_Replay_Entry_Kind {
+    SIM_REPLAY_ENTRY_END = 0,   // Nothing left.
+    SIM_REPLAY_ENTRY_ERROR = 1, // Stream is cut short or malformed.
+    SIM_REPLAY_ENTRY_GAME_START = 2,
+    SIM_REPLAY_ENTRY_GAME_END = 3,
+    SIM_REPLAY_ENTRY_RUN = 4,   // 'input' for 'count' ticks.
+    SIM_REPLAY_ENTRY_GROUP = 5, // 'count' directions in 'packed', see 'sim_replay_get_packed_input()'.
+    SIM_REPLAY_ENTRY_KEYFRAME = 6,
+};
+
+struct Sim_Replay_Entry {
+    u32 kind;
+
+    // GAME_START
+    u64 seed;
+    int width;
+    int height;
+
+    // GAME_END, KEYFRAME
+    u32 end_reason;
+    u64 tick; // Ticks into the game for keyframes.
+    int score;
+    int moves;
+    u64 hash;
+
+    // RUN, GROUP
+    Sim_Input input;
+    u32 count;
+    const u8 *packed;
+
+    // KEYFRAME
+    const u8 *state; // State block inside the replay, not aligned.
+    u64 state_size;
+    u64 checksum;
+};
+
+// What 'sim_replay_play_inputs()' did to the state.
+struct Sim_Replay_Playback {
+    u64 ticks;   // Inputs stepped.
+    u64 ignored; // Inputs after the rules had ended the game, not stepped. Never any in a good replay.
+    u32 events;  // Sim_Event flags of the last tick stepped.
+    u32 keyframes;
+    u32 keyframes_differ; // Keyframes whose tick or hash the played state doesn't have.
+};
+
+// Games and keyframes of a replay, see 'sim_replay_load_index()'. Records are
+// the footer's layout, read with 'sim_replay_get_index_game()'.
+struct Sim_Replay_Index {
+    const u8 *games;
+    const u8 *keyframes;
+    u32 games_count;
+    u32 keyframes_count;
+    u8 *built; // Own memory when the file had no footer, NULL when it's the file's.
+};
+
+// Tick by tick position in one game, made by 'sim_replay_seek()'.
+struct Sim_Replay_Cursor {
+    Sim_Replay_Reader reader; // Right after 'entry'.
+    Sim_Replay_Entry entry;   // Inputs being stepped through, 'entry_at' of them are done.
+    u32 entry_at;
+    u64 tick;   // Ticks into the game.
+    u32 events; // Sim_Event flags of the last tick stepped.
+    bool ended; // Recording of the game ended, or the rules ended the game.
+};
+
+//
+// --- Functions ---
+//
+bool sim_replay_open(Sim_Replay_Writer *writer, const char *path, int compression_level, const void *dictionary, u64 dictionary_size);
+void sim_replay_close(Sim_Replay_Writer *writer);
+void sim_replay_begin_game(Sim_Replay_Writer *writer, Sim_State *state);
+void sim_replay_begin_edited_game(Sim_Replay_Writer *writer, Sim_State *state);
+void sim_replay_end_game(Sim_Replay_Writer *writer, Sim_State *state, u32 reason);
+void sim_replay_close_run(Sim_Replay_Writer *writer);
+void sim_replay_write_keyframe(Sim_Replay_Writer *writer, Sim_State *state);
+bool sim_replay_open_reader(Sim_Replay_Reader *reader, const void *data, u64 size);
+u32 sim_replay_read(Sim_Replay_Reader *reader, Sim_Replay_Entry *entry);
+bool sim_replay_find_game(Sim_Replay_Reader *reader, u64 *begin, u64 *end);
+bool sim_replay_start_game(Sim_Replay_Reader *reader, Sim_Replay_Entry *start, Sim_State *state);
+u32 sim_replay_play_inputs(Sim_Replay_Reader *reader, Sim_State *state, Sim_Replay_Entry *entry, Sim_Replay_Playback *playback);
+bool sim_replay_load_index(Sim_Replay_Index *index, Sim_Replay_Reader *reader);
+void sim_replay_free_index(Sim_Replay_Index *index);
+bool sim_replay_get_index_game(Sim_Replay_Index *index, u32 game, Sim_Replay_Index_Game *result);
+bool sim_replay_get_game_start(Sim_Replay_Reader *reader, Sim_Replay_Index *index, u32 game, Sim_Replay_Entry *start);
+bool sim_replay_seek(Sim_Replay_Cursor *cursor, Sim_Replay_Reader *reader, Sim_Replay_Index *index, u32 game, u64 tick, Sim_State *state, bool use_keyframes);
+u64 sim_replay_step(Sim_Replay_Cursor *cursor, Sim_State *state, u64 ticks);
+const char *sim_get_replay_end_reason_name(u32 reason);
+
+/*inline*/ void sim_replay_record_input(Sim_Replay_Writer *writer, Sim_State *state, Sim_Input input);
+/*inline*/ Sim_Input sim_replay_get_packed_input(const u8 *packed, u32 index);
+
+//
+// --- Inline functions ---
+//
+
+// After every 'sim_step()' of a game between 'sim_replay_begin_game()' and
+// 'sim_replay_end_game()', with the state it left. Going the same way as the
+// tick before is a counter increment, a turn packs the run before it.
+inline void sim_replay_record_input(Sim_Replay_Writer *writer, Sim_State *state, Sim_Input input) {
+    if (!writer->in_game) {
+        return;
+    }
+    writer->ticks++;
+    if (input == writer->run_input && writer->run_length < U32_MAX) {
+        writer->run_length++;
+    } else {
+        sim_replay_close_run(writer);
+        writer->run_input = input;
+        writer->run_length = 1;
+    }
+    if (writer->ticks == writer->next_keyframe) {
+        sim_replay_write_keyframe(writer, state);
+    }
+}
+
+inline Sim_Input sim_replay_get_packed_input(const u8 *packed, u32 index) {
+    return (Sim_Input)(SIM_INPUT_UP + ((packed[index >> 2] >> ((index & 3) * 2)) & 3));
+}
+
+#endif /*SNAKE_SIM_REPLAY_H*/
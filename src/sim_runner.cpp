@@ -0,0 +1,366 @@
+// assert()
+#include <assert.h>
+// placement new
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "sim_runner.h"
+
+//
+// --- Work-stealing deque ---
+//
+
+// Consecutive game numbers, played by whichever worker gets the task.
+struct Sim_Task {
+    u64 first_game;
+    u64 games_count;
+};
+
+// Chase-Lev deque (the C11 version by Le, Pop, Cohen and Zappa Nardelli).
+// Its owner pushes and takes at the bottom, any other worker steals from
+// the top, and only the last task left is ever fought over with a CAS.
+// Capacity is fixed: every task is pushed before the workers start, so a
+// slot is never written again while a thief could still be reading it.
+struct Task_Deque {
+    alignas(64) std::atomic<s64> top;
+    alignas(64) std::atomic<s64> bottom;
+    alignas(64) Sim_Task *tasks;
+    s64 mask;
+};
+
+enum Steal_Result {
+    STEAL_EMPTY = 0,
+    STEAL_LOST_RACE = 1, // Someone else took it first, the deque may still have more.
+    STEAL_SUCCESS = 2,
+};
+
+// Owner only.
+static void task_deque_push(Task_Deque *deque, Sim_Task task) {
+    s64 bottom = deque->bottom.load(std::memory_order_relaxed);
+    s64 top = deque->top.load(std::memory_order_acquire);
+    assert(bottom - top <= deque->mask);
+    (void)top;
+
+    deque->tasks[bottom & deque->mask] = task;
+    std::atomic_thread_fence(std::memory_order_release);
+    deque->bottom.store(bottom + 1, std::memory_order_relaxed);
+}
+
+// Owner only. Newest task first.
+static bool task_deque_take(Task_Deque *deque, Sim_Task *task) {
+    s64 bottom = deque->bottom.load(std::memory_order_relaxed) - 1;
+    deque->bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    s64 top = deque->top.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+        deque->bottom.store(bottom + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    *task = deque->tasks[bottom & deque->mask];
+    if (top == bottom) {
+        // Last one, a thief could be taking it right now.
+        bool won = deque->top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        deque->bottom.store(bottom + 1, std::memory_order_relaxed);
+        return won;
+    }
+    return true;
+}
+
+// Any worker but the owner. Oldest task first.
+static Steal_Result task_deque_steal(Task_Deque *deque, Sim_Task *task) {
+    s64 top = deque->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    s64 bottom = deque->bottom.load(std::memory_order_acquire);
+    if (top >= bottom) {
+        return STEAL_EMPTY;
+    }
+
+    *task = deque->tasks[top & deque->mask];
+    if (!deque->top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return STEAL_LOST_RACE;
+    }
+    return STEAL_SUCCESS;
+}
+
+//
+// --- Workers ---
+//
+
+// Everything a worker writes during the run is in its own 'Runner_Worker'
+// or its own arena. Deques are the only thing shared.
+struct Runner_Worker {
+    Task_Deque deque;
+    alignas(64) Sim_Runner_Result result;
+    bool failed; // Couldn't get memory for its batch, the others played its tasks.
+};
+
+struct Runner {
+    Sim_Runner_Config *config;
+    Runner_Worker *workers;
+    int workers_count;
+};
+
+// Different seeds for neighbouring game numbers (SplitMix64 finalizer),
+// so games next to each other don't start from related generator states.
+static u64 get_game_seed(u64 seed, u64 game) {
+    u64 z = seed + (game + 1) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Own tasks first, then the others', starting from the next worker so
+// thieves spread out instead of all going after the same one. Returns
+// false only once every deque was seen empty in one sweep, and since
+// nothing is pushed during the run, they stay that way.
+static bool get_task(Runner *runner, int worker_index, Sim_Task *task) {
+    Runner_Worker *worker = &runner->workers[worker_index];
+    if (task_deque_take(&worker->deque, task)) {
+        return true;
+    }
+
+    for (;;) {
+        bool lost_race = false;
+        ForFrom (runner->workers_count, 1) {
+            int victim = (worker_index + it) % runner->workers_count;
+            Steal_Result stolen = task_deque_steal(&runner->workers[victim].deque, task);
+            if (stolen == STEAL_SUCCESS) {
+                worker->result.steals++;
+                return true;
+            }
+            lost_race = lost_race || (stolen == STEAL_LOST_RACE);
+        }
+        if (!lost_race) {
+            return false;
+        }
+    }
+}
+
+static void record_game(Sim_Runner_Result *result, Sim_Batch *batch, u32 slot, u32 events) {
+    result->games++;
+    result->total_score += (u64)batch->score[slot];
+    result->max_score = glm::max(result->max_score, batch->score[slot]);
+    if (events & SIM_EVENT_WON) {
+        result->wins++;
+    } else if (events & SIM_EVENT_DIED) {
+        result->deaths++;
+    } else {
+        result->timeouts++;
+    }
+}
+
+// Keeps every slot of its batch busy with the next game of the current task
+// until there are no tasks left anywhere.
+static void run_worker(Runner *runner, int worker_index) {
+    Sim_Runner_Config *config = runner->config;
+    Runner_Worker *worker = &runner->workers[worker_index];
+    Sim_Runner_Result *result = &worker->result;
+    u32 slots = config->batch_games;
+
+    // Allocated here so its pages are first touched by the thread using them.
+    u64 needed = sim_batch_get_memory_size(config->width, config->height, slots) +
+                 slots * (sizeof(Sim_Rng) + 2 * sizeof(u8)) + 3 * 64;
+    Memory_Arena arena = alloc_memory_arena(needed);
+    Sim_Batch batch;
+    if (!arena.data || !sim_batch_init(&batch, &arena, config->width, config->height, slots)) {
+        worker->failed = true;
+        free_memory_arena(&arena);
+        return;
+    }
+    Sim_Rng *rngs = (Sim_Rng *) push_memory_arena(&arena, slots * sizeof(Sim_Rng));
+    u8 *inputs = (u8 *) push_memory_arena(&arena, slots * sizeof(u8));
+    u8 *events = (u8 *) push_memory_arena(&arena, slots * sizeof(u8));
+
+    Sim_Task task = {};
+    bool out_of_tasks = false;
+    u32 active = 0;
+    for (;;) {
+        for (u32 slot = 0; slot < slots && !out_of_tasks; slot++) {
+            if (!batch.done[slot]) {
+                continue;
+            }
+            if (task.games_count == 0 && !get_task(runner, worker_index, &task)) {
+                out_of_tasks = true;
+                break;
+            }
+
+            u64 game = task.first_game++;
+            task.games_count--;
+            u64 seed = get_game_seed(config->seed, game);
+            sim_batch_reset_game(&batch, slot, seed);
+            sim_rng_seed(&rngs[slot], seed, 1); // Game itself uses stream 0.
+            active++;
+        }
+        if (active == 0) {
+            break;
+        }
+
+        config->policy(&batch, rngs, inputs, config->policy_data);
+        sim_batch_step(&batch, inputs, events);
+
+        for (u32 slot = 0; slot < slots; slot++) {
+            u32 slot_events = events[slot];
+            if (slot_events & SIM_EVENT_MOVED) {
+                result->ticks++;
+            }
+
+            bool ended = slot_events & (SIM_EVENT_DIED | SIM_EVENT_WON);
+            bool timed_out = !batch.done[slot] && config->max_moves > 0 && batch.moves[slot] >= config->max_moves;
+            if (ended || timed_out) {
+                record_game(result, &batch, slot, slot_events);
+                batch.done[slot] = 1;
+                active--;
+            }
+        }
+    }
+
+    free_memory_arena(&arena);
+}
+
+//
+// --- Runner ---
+//
+Sim_Runner_Config sim_runner_default_config() {
+    Sim_Runner_Config config = {};
+    config.width = SIM_DEFAULT_BOARD_WIDTH;
+    config.height = SIM_DEFAULT_BOARD_HEIGHT;
+    config.games_count = 1000000;
+    config.seed = 1;
+    config.threads_count = 0;
+    config.batch_games = 32;
+    config.task_games = 1024;
+    config.max_moves = 10000;
+    config.policy = sim_policy_random_safe;
+    config.policy_data = NULL;
+    return config;
+}
+
+// At least 1, even when the platform can't tell.
+int sim_runner_get_hardware_threads() {
+    int threads = (int)std::thread::hardware_concurrency();
+    return (threads > 0) ? threads : 1;
+}
+
+// Plays 'config->games_count' games and sums up how they went. Blocks until
+// all of them are done, the calling thread works as one of the workers.
+// Returns false when the config is invalid or a worker couldn't get memory,
+// 'result' still has whatever was played.
+bool sim_run_games(Sim_Runner_Config *config, Sim_Runner_Result *result) {
+    *result = Sim_Runner_Result();
+    if (config->width < SIM_BOARD_SIDE_MIN || config->width > SIM_BOARD_SIDE_MAX ||
+        config->height < SIM_BOARD_SIDE_MIN || config->height > SIM_BOARD_SIDE_MAX ||
+        config->batch_games == 0 || config->task_games == 0 || !config->policy) {
+        return false;
+    }
+
+    int workers_count = (config->threads_count > 0) ? config->threads_count : sim_runner_get_hardware_threads();
+    u64 tasks_count = (config->games_count + config->task_games - 1) / config->task_games;
+
+    // Workers get consecutive tasks, at most this many each.
+    u64 tasks_per_worker = (tasks_count + workers_count - 1) / workers_count;
+    u64 deque_capacity = 1;
+    while (deque_capacity < tasks_per_worker) {
+        deque_capacity <<= 1;
+    }
+
+    Memory_Arena arena = alloc_memory_arena(workers_count * (sizeof(Runner_Worker) + 64) +
+                                            workers_count * (deque_capacity * sizeof(Sim_Task) + 64));
+    Runner runner;
+    runner.config = config;
+    runner.workers_count = workers_count;
+    runner.workers = (Runner_Worker *) push_memory_arena(&arena, workers_count * sizeof(Runner_Worker));
+    if (!runner.workers) {
+        free_memory_arena(&arena);
+        return false;
+    }
+
+    For (workers_count) {
+        Runner_Worker *worker = new (&runner.workers[it]) Runner_Worker();
+        worker->deque.tasks = (Sim_Task *) push_memory_arena(&arena, deque_capacity * sizeof(Sim_Task));
+        worker->deque.mask = (s64)deque_capacity - 1;
+
+        // Pushed backwards, so the owner plays its games in order
+        // and thieves take the ones it would get to last.
+        u64 first_task = glm::min(tasks_count, (u64)it * tasks_per_worker);
+        u64 end_task = glm::min(tasks_count, first_task + tasks_per_worker);
+        for (u64 task_index = end_task; task_index > first_task; task_index--) {
+            Sim_Task task;
+            task.first_game = (task_index - 1) * config->task_games;
+            task.games_count = glm::min((u64)config->task_games, config->games_count - task.first_game);
+            task_deque_push(&worker->deque, task);
+        }
+    }
+
+    using namespace std::chrono;
+    steady_clock::time_point start = steady_clock::now();
+
+    std::thread *threads = new std::thread[workers_count];
+    ForFrom (workers_count, 1) {
+        threads[it] = std::thread(run_worker, &runner, it);
+    }
+    run_worker(&runner, 0);
+    ForFrom (workers_count, 1) {
+        threads[it].join();
+    }
+    delete[] threads;
+
+    result->seconds = duration<double>(steady_clock::now() - start).count();
+    result->threads_count = workers_count;
+
+    bool failed = false;
+    For (workers_count) {
+        Sim_Runner_Result *worker_result = &runner.workers[it].result;
+        result->games += worker_result->games;
+        result->ticks += worker_result->ticks;
+        result->total_score += worker_result->total_score;
+        result->deaths += worker_result->deaths;
+        result->wins += worker_result->wins;
+        result->timeouts += worker_result->timeouts;
+        result->max_score = glm::max(result->max_score, worker_result->max_score);
+        result->steals += worker_result->steals;
+        failed = failed || runner.workers[it].failed;
+    }
+
+    free_memory_arena(&arena);
+    return !failed;
+}
+
+//
+// --- Policies ---
+//
+
+// Random direction among the ones that don't run into a wall or the player,
+// the same check 'sim_step()' makes (the last tail still blocks its tile).
+// Goes up when nothing is safe.
+void sim_policy_random_safe(Sim_Batch *batch, Sim_Rng *rngs, u8 *inputs, void *data) {
+    (void)data;
+    for (u32 game = 0; game < batch->games_count; game++) {
+        if (batch->done[game]) {
+            inputs[game] = SIM_INPUT_NONE;
+            continue;
+        }
+
+        u32 *occupancy = batch->occupancy + (u64)game * batch->occupancy_words;
+        u8 safe[4];
+        u32 safe_count = 0;
+        For (4) {
+            Sim_Input input = (Sim_Input)(SIM_INPUT_UP + it);
+            Vec2i direction = sim_input_direction(input);
+            int x = batch->head_x[game] + direction.x;
+            int y = batch->head_y[game] + direction.y;
+            if ((u32)x >= (u32)batch->width || (u32)y >= (u32)batch->height) {
+                continue;
+            }
+            u32 index = (u32)y * (u32)batch->width + (u32)x;
+            if ((occupancy[index >> 5] >> (index & 31)) & 1) {
+                continue;
+            }
+            safe[safe_count++] = (u8)input;
+        }
+        inputs[game] = safe_count ? safe[sim_rng_bounded(&rngs[game], safe_count)] : (u8)SIM_INPUT_UP;
+    }
+}
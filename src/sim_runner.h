@@ -0,0 +1,60 @@
+#ifndef SNAKE_SIM_RUNNER_H
+#define SNAKE_SIM_RUNNER_H
+
+// Plays a large number of independent games on every hardware thread.
+//
+// Games are split into tasks of consecutive game numbers, dealt out to one
+// work-stealing deque per worker up front. Workers play their own tasks on
+// a 'Sim_Batch' in their own arena, and steal from others when they run
+// out. Every game's seed and policy randomness come from its number, so
+// results are the same for any thread count and any scheduling.
+
+#include "sim_batch.h"
+
+//
+// --- Structs ---
+//
+struct Sim_Runner_Config;
+struct Sim_Runner_Result;
+
+// Fills 'inputs' for every game of the batch that isn't done. 'rngs' has one
+// generator per game slot, seeded from the number of the game in it.
+typedef void (*Sim_Policy)(Sim_Batch *batch, Sim_Rng *rngs, u8 *inputs, void *data);
+
+struct Sim_Runner_Config {
+    int width;
+    int height;
+    u64 games_count;
+    u64 seed;              // Game 'n' plays with a seed made from this and 'n'.
+    int threads_count;     // 0 for every hardware thread.
+    u32 batch_games;       // Game slots each worker steps at once.
+    u32 task_games;        // Games per task, the unit of stealing.
+    int max_moves;         // Games still alive after this many moves end as timed out.
+    Sim_Policy policy;
+    void *policy_data;
+};
+
+// Totals over all games. 'ticks' counts moves that were made, so it's the
+// sum of every game's moves.
+struct Sim_Runner_Result {
+    u64 games;
+    u64 ticks;
+    u64 total_score;
+    u64 deaths;
+    u64 wins;
+    u64 timeouts;
+    int max_score;
+    int threads_count;
+    u64 steals; // Tasks a worker took from another one.
+    double seconds;
+};
+
+//
+// --- Functions ---
+//
+Sim_Runner_Config sim_runner_default_config();
+int sim_runner_get_hardware_threads();
+bool sim_run_games(Sim_Runner_Config *config, Sim_Runner_Result *result);
+void sim_policy_random_safe(Sim_Batch *batch, Sim_Rng *rngs, u8 *inputs, void *data);
+
+#endif /*SNAKE_SIM_RUNNER_H*/
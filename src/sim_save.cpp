@@ -0,0 +1,255 @@
+// fopen(), fwrite(), remove(), rename()
+#include <stdio.h>
+// malloc(), free()
+#include <stdlib.h>
+// memset(), memcpy()
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "sim_save.h"
+
+static_assert(sizeof(Sim_Save_Header) == 64, "Sim_Save_Header has to stay one cache line");
+
+const u64 CHECKSUM_PRIME_1 = 0x9E3779B185EBCA87ull;
+const u64 CHECKSUM_PRIME_2 = 0xC2B2AE3D27D4EB4Full;
+
+static inline u64 rotate_left(u64 value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline void checksum_block(u64 *lanes, const u8 *block) {
+    u64 words[4];
+    memcpy(words, block, sizeof(words));
+    For (4) {
+        lanes[it] = rotate_left(lanes[it] + words[it] * CHECKSUM_PRIME_2, 31) * CHECKSUM_PRIME_1;
+    }
+}
+
+// 64-bit checksum for save files. Four independent lanes over 32-byte blocks,
+// so the multiplies overlap and it runs at several bytes per cycle.
+u64 sim_checksum(const void *data, u64 size) {
+    ZoneScoped;
+
+    const u8 *bytes = (const u8 *)data;
+    u64 lanes[4] = { CHECKSUM_PRIME_1 + CHECKSUM_PRIME_2, CHECKSUM_PRIME_2, 0, 0 - CHECKSUM_PRIME_1 };
+
+    u64 blocks = size / 32;
+    for (u64 block = 0; block < blocks; block++) {
+        checksum_block(lanes, bytes + block * 32);
+    }
+    u8 last[32] = {};
+    memcpy(last, bytes + blocks * 32, (size_t)(size % 32));
+    checksum_block(lanes, last);
+
+    u64 hash = size * CHECKSUM_PRIME_1;
+    For (4) {
+        hash = (hash ^ rotate_left(lanes[it], 1 + it * 7)) * CHECKSUM_PRIME_2;
+    }
+    hash ^= hash >> 33;
+    hash *= CHECKSUM_PRIME_1;
+    hash ^= hash >> 29;
+    return hash;
+}
+
+// Writes 'state' next to 'path' first and then moves it over, so a crash
+// halfway leaves the previous save as it was. Costs one write of the state
+// block and a checksum over it, plus compressing it when 'compressor' isn't
+// NULL.
+u32 sim_write_save(const char *path, Sim_State *state, Sim_Compressor *compressor) {
+    ZoneScoped;
+
+    Sim_Save_Header header = {};
+    header.magic = SIM_SAVE_MAGIC;
+    header.version = SIM_SAVE_VERSION;
+    header.header_size = sizeof(Sim_Save_Header);
+    header.state_struct_size = sizeof(Sim_State);
+    header.width = state->width;
+    header.height = state->height;
+    header.state_size = state->size;
+    header.checksum = sim_checksum(state, state->size);
+    header.stored_size = state->size;
+
+    const void *stored = state;
+    u8 *compressed = NULL;
+    if (compressor) {
+        u64 capacity = sim_get_compressed_size_max(state->size);
+        compressed = (u8 *) malloc((size_t)capacity);
+        header.stored_size = compressed ? sim_compress(compressor, compressed, capacity, state, state->size) : 0;
+        if (header.stored_size == 0) {
+            free(compressed);
+            return SIM_SAVE_CANT_WRITE;
+        }
+        header.flags |= SIM_SAVE_COMPRESSED;
+        stored = compressed;
+    }
+
+    char temporary_path[1024];
+    FILE *file = NULL;
+    if (snprintf(temporary_path, sizeof(temporary_path), "%s.tmp", path) < (int)sizeof(temporary_path)) {
+        file = fopen(temporary_path, "wb");
+    }
+    if (!file) {
+        free(compressed);
+        return SIM_SAVE_CANT_OPEN;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   fwrite(stored, 1, (size_t)header.stored_size, file) == header.stored_size;
+    written = (fclose(file) == 0) && written;
+    free(compressed);
+    if (!written) {
+        remove(temporary_path);
+        return SIM_SAVE_CANT_WRITE;
+    }
+
+#if defined(_WIN32)
+    bool moved = MoveFileExA(temporary_path, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    bool moved = rename(temporary_path, path) == 0;
+#endif
+    if (!moved) {
+        remove(temporary_path);
+        return SIM_SAVE_CANT_WRITE;
+    }
+    return SIM_SAVE_OK;
+}
+
+// Maps the save at 'path' and points 'mapping->state' at the state in it.
+// Pages are read on first touch, so without 'verify_checksum' this costs
+// the same for any board size. Checksumming reads the whole block once.
+// Compressed saves are decompressed into 'mapping->decompressed' instead,
+// and always checksummed.
+// On anything but SIM_SAVE_OK the mapping is already released.
+u32 sim_map_save(const char *path, Sim_Save_Mapping *mapping, bool verify_checksum) {
+    ZoneScoped;
+
+    memset(mapping, 0, sizeof(Sim_Save_Mapping));
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return SIM_SAVE_CANT_OPEN;
+    }
+    mapping->file = file;
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || (u64)file_size.QuadPart < sizeof(Sim_Save_Header)) {
+        sim_unmap_save(mapping);
+        return SIM_SAVE_NOT_A_SAVE;
+    }
+    mapping->size = (u64)file_size.QuadPart;
+    mapping->mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    mapping->data = mapping->mapping ? MapViewOfFile(mapping->mapping, FILE_MAP_COPY, 0, 0, 0) : NULL;
+#else
+    int file = open(path, O_RDONLY);
+    if (file < 0) {
+        return SIM_SAVE_CANT_OPEN;
+    }
+    struct stat file_stat;
+    if (fstat(file, &file_stat) != 0 || (u64)file_stat.st_size < sizeof(Sim_Save_Header)) {
+        close(file);
+        return SIM_SAVE_NOT_A_SAVE;
+    }
+    mapping->size = (u64)file_stat.st_size;
+    void *data = mmap(NULL, (size_t)mapping->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    mapping->data = (data == MAP_FAILED) ? NULL : data;
+    close(file); // Mapping keeps the file alive.
+#endif
+    if (!mapping->data) {
+        sim_unmap_save(mapping);
+        return SIM_SAVE_CANT_OPEN;
+    }
+
+    Sim_Save_Header *header = (Sim_Save_Header *)mapping->data;
+    u32 result = SIM_SAVE_OK;
+    if (header->magic != SIM_SAVE_MAGIC) {
+        result = SIM_SAVE_NOT_A_SAVE;
+    } else if (header->version != SIM_SAVE_VERSION || header->header_size != sizeof(Sim_Save_Header) ||
+               header->state_struct_size != sizeof(Sim_State)) {
+        result = SIM_SAVE_WRONG_VERSION;
+    } else if (header->width < SIM_BOARD_SIDE_MIN || header->width > SIM_BOARD_SIDE_MAX ||
+               header->height < SIM_BOARD_SIDE_MIN || header->height > SIM_BOARD_SIDE_MAX ||
+               header->state_size != sim_get_state_size(header->width, header->height) ||
+               header->stored_size != mapping->size - header->header_size ||
+               (!(header->flags & SIM_SAVE_COMPRESSED) && header->stored_size != header->state_size)) {
+        result = SIM_SAVE_BAD_STATE;
+    }
+
+    Sim_State *state = (Sim_State *)((u8 *)mapping->data + header->header_size);
+    if (result == SIM_SAVE_OK && (header->flags & SIM_SAVE_COMPRESSED)) {
+        // Size is known to be a board's from the checks above, so this is no bigger than the game would make.
+        mapping->decompressed = alloc_memory_arena(header->state_size + 63);
+        void *memory = push_memory_arena(&mapping->decompressed, header->state_size);
+        Sim_Decompressor decompressor;
+        if (!memory || !sim_init_decompressor(&decompressor, NULL, 0)) {
+            result = SIM_SAVE_CANT_OPEN;
+        } else {
+            if (sim_decompress(&decompressor, memory, header->state_size, state, header->stored_size) != header->state_size) {
+                result = SIM_SAVE_BAD_CHECKSUM;
+            }
+            sim_free_decompressor(&decompressor);
+            state = (Sim_State *)memory;
+        }
+    }
+
+    // Damaged frames can decompress to the right size, so those are always checked.
+    bool compressed = (header->flags & SIM_SAVE_COMPRESSED) != 0;
+    if (result == SIM_SAVE_OK && (verify_checksum || compressed) && sim_checksum(state, header->state_size) != header->checksum) {
+        result = SIM_SAVE_BAD_CHECKSUM;
+    }
+    if (result == SIM_SAVE_OK) {
+        if (!sim_check_state(state, header->state_size) || state->width != header->width || state->height != header->height) {
+            result = SIM_SAVE_BAD_STATE;
+        } else {
+            // Kernels are picked per build, the saving one may have had others.
+            state->kernel = sim_pick_kernel(state->width, state->height);
+            mapping->state = state;
+        }
+    }
+
+    if (result != SIM_SAVE_OK) {
+        sim_unmap_save(mapping);
+    }
+    return result;
+}
+
+void sim_unmap_save(Sim_Save_Mapping *mapping) {
+#if defined(_WIN32)
+    if (mapping->data) {
+        UnmapViewOfFile(mapping->data);
+    }
+    if (mapping->mapping) {
+        CloseHandle((HANDLE)mapping->mapping);
+    }
+    if (mapping->file) {
+        CloseHandle((HANDLE)mapping->file);
+    }
+#else
+    if (mapping->data) {
+        munmap(mapping->data, (size_t)mapping->size);
+    }
+#endif
+    free_memory_arena(&mapping->decompressed);
+    memset(mapping, 0, sizeof(Sim_Save_Mapping));
+}
+
+const char *sim_get_save_result_name(u32 result) {
+    switch (result) {
+        case SIM_SAVE_OK:             return "OK";
+        case SIM_SAVE_CANT_OPEN:      return "Couldn't open the file";
+        case SIM_SAVE_CANT_WRITE:     return "Couldn't write the file";
+        case SIM_SAVE_NOT_A_SAVE:     return "Not a save file";
+        case SIM_SAVE_WRONG_VERSION:  return "Saved by a different version";
+        case SIM_SAVE_BAD_STATE:      return "Save doesn't hold a valid game";
+        case SIM_SAVE_BAD_CHECKSUM:   return "Save is corrupted";
+    }
+    return "Unknown";
+}
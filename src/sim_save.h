@@ -0,0 +1,80 @@
+#ifndef SNAKE_SIM_SAVE_H
+#define SNAKE_SIM_SAVE_H
+
+// Game saves that load without parsing.
+//
+// A save is a Sim_Save_Header and then the state block byte for byte, the
+// way it is in memory. The state has no pointers inside, so a mapped save
+// is a working 'Sim_State' as soon as the header checks out: a large board
+// loads in the time it takes to map the file, or to checksum it when asked.
+// Mappings are copy-on-write, stepping a mapped state never changes the file.
+//
+// The block layout is the in-memory one, so saves only load on builds with
+// the same SIM_SAVE_VERSION, 'Sim_State' size and byte order.
+//
+// Saves can also be written compressed (SIM_SAVE_COMPRESSED), for when the
+// file size matters more than loading by mapping. Those are decompressed
+// into memory of their own on load.
+
+#include "sim.h"
+#include "sim_compress.h"
+
+//
+// --- Constants ---
+//
+const u64 SIM_SAVE_MAGIC = 0x564153454B414E53ull; // "SNAKESAV"
+const u32 SIM_SAVE_VERSION = 2; // Bump on any change to 'Sim_State' or its arrays.
+
+// Sim_Save_Header flags.
+const u32 SIM_SAVE_COMPRESSED = (1 << 0); // State is one zstd frame, 'stored_size' bytes.
+
+//
+// --- Structs ---
+//
+struct Sim_Save_Header;
+struct Sim_Save_Mapping;
+
+// One cache line, so the state after it is as aligned as the mapping.
+struct Sim_Save_Header {
+    u64 magic;
+    u32 version;
+    u32 header_size;       // State starts this far into the file.
+    u32 state_struct_size; // sizeof(Sim_State) of the build that saved it.
+    int width;
+    int height;
+    u32 flags;
+    u64 state_size;        // Same as the state's 'size'.
+    u64 checksum;          // 'sim_checksum()' of the state block, uncompressed.
+    u64 stored_size;       // Bytes of the state in the file.
+    u64 reserved;
+};
+
+struct Sim_Save_Mapping {
+    Sim_State *state; // Inside the mapping, valid until 'sim_unmap_save()'.
+    void *data;
+    u64 size;
+    void *file;    // Platform handles.
+    void *mapping;
+    Memory_Arena decompressed; // Holds the state when the save is compressed.
+};
+
+enum Sim_Save_Result {
+    SIM_SAVE_OK = 0,
+    SIM_SAVE_CANT_OPEN = 1,
+    SIM_SAVE_CANT_WRITE = 2,
+    SIM_SAVE_NOT_A_SAVE = 3,      // Too short or wrong magic.
+    SIM_SAVE_WRONG_VERSION = 4,   // Saved by a build with another state layout.
+    SIM_SAVE_BAD_STATE = 5,       // Header and state don't describe a valid board.
+    SIM_SAVE_BAD_CHECKSUM = 6,
+};
+
+//
+// --- Functions ---
+//
+u64 sim_checksum(const void *data, u64 size);
+u32 sim_write_save(const char *path, Sim_State *state, Sim_Compressor *compressor);
+u32 sim_map_save(const char *path, Sim_Save_Mapping *mapping, bool verify_checksum);
+void sim_unmap_save(Sim_Save_Mapping *mapping);
+const char *sim_get_save_result_name(u32 result);
+
+#endif /*SNAKE_SIM_SAVE_H*/
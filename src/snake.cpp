@@ -2,8 +2,14 @@
 // #include <imgui/imgui_impl_glfw.h>
 // #include <imgui/imgui_impl_opengl3.h>
 
-// time()
+// time(), localtime(), strftime()
 #include <time.h>
+// fopen(), snprintf()
+#include <stdio.h>
+
+// std::thread, std::this_thread::sleep_for()
+#include <thread>
+#include <chrono>
 
 // glm::perspective, glm::lookAt
 #include <GLM/gtc/matrix_transform.hpp>
@@ -20,7 +26,7 @@
 extern Player player;
 extern Resource resource;
 extern u32 game_state;
-extern bool imgui_states[] = { true, false, false, false, false, false };
+extern bool imgui_states[] = { true, false, false, false, false, false, false, false, false };
 
 // Globals from renderer.cpp
 Screen screen;
@@ -33,56 +39,151 @@ static Stats stats;
 static Vec2i player_move;
 static Vec2i resource_move;
 
-static Tail tails[PLAYER_TAIL_LENGTH_MAX];
+// Game rules state. Owned by the simulation thread while it runs, the main
+// thread only touches it (and 'seed_rng') while the thread is stopped.
+// Lives at the start of 'board_arena', one block for the whole game.
+// Everything else it needs comes from 'game_snapshot'.
+static Sim_State *sim;
+static Sim_History history; // Owned the same way as 'sim', storage is in 'board_arena' too.
+static Memory_Arena board_arena;
+static Vec2i board_size = new_vec2i(SIM_DEFAULT_BOARD_WIDTH, SIM_DEFAULT_BOARD_HEIGHT);
+
+// Render-side tail colors. Main thread only, sized for the board in 'board_arena'.
+static Tail *tails;
+static int tails_capacity;
+
+// End colors the tails gradient was last made with. It only depends on them
+// and 'tails_capacity', so it's remade when one of those changes and frames
+// in between don't touch the tails at all.
+static glm::vec3 tails_gradient_start;
+static glm::vec3 tails_gradient_end;
+static bool tails_gradient_valid;
+
+// Simulation thread publishes into 'snapshots' whenever the game changed,
+// main thread takes the newest one into 'game_snapshot' once per frame.
+static Triple_Buffer<Game_Snapshot> snapshots;
+Game_Snapshot *game_snapshot;
+static bool snapshot_dirty;
+
+static std::thread sim_thread;
+static std::atomic<bool> sim_thread_running{false};
+
+// Written by the main thread, read by the simulation thread.
+// Real-time mode: player keeps moving towards 'heading' once every tick.
+// Turn-based mode moves only on key presses.
+static std::atomic<bool> sim_playing{false};
+static std::atomic<bool> real_time_mode{false};
+static std::atomic<int> tick_rate_hz{TICK_RATE_DEFAULT_HZ};
+
+// Simulation thread only.
+static double tick_accumulator;
+static double tick_last_update_time;
+static Sim_Input heading = SIM_INPUT_NONE;
+static Input_Event turn_buffer[TURN_BUFFER_CAPACITY];
+static int turn_count;
+static Input_Stats input_stats;
+
+// Filled by the main thread (key callback, buttons, ImGui), drained by 'update_game_ticks()'.
+static Spsc_Queue<Game_Command, COMMAND_QUEUE_CAPACITY> command_queue;
+static u64 commands_dropped; // Main thread only, queue was full.
+
+// Every consumer of game events gets one, the log printed from the main thread is one of them.
+static Game_Event_Stream game_event_streams[GAME_EVENT_STREAMS_MAX];
+static Game_Event_Stream *log_events;   // Main thread only.
+static double log_game_start_time;      // Main thread only, time of the last reset it printed.
+
+// Copy of the state taken for a save, written out by 'save_thread' while the
+// game goes on. 'save_writing' is set until the file is done.
+static Sim_State *save_state;
+static std::thread save_thread;
+static std::atomic<bool> save_writing{false};
+
+// Every tick of every game goes in here, simulation thread only. An edit
+// ends the recorded game and sets 'replay_edited', the next tick starts a new
+// one from the edited state.
+static Sim_Replay_Writer replay;
+static bool replay_edited;
+
+// Seeds for every new game come from here, so a whole session is
+// reproducible from the one seed it starts with.
+static Sim_Rng seed_rng;
 
 //
 // --- ImGui input ---
 //
-float *imgui_playerdrag[4] = { &player.x, &player.y, &player.prev_x, &player.prev_y };
-float *imgui_resourcedrag[2] = { &resource.x, &resource.y };
+Vec2i imgui_player_tile;
+Vec2i imgui_resource_tile;
 int imgui_tail_num = 0;
-float *imgui_taildrag[4] = { &tails[imgui_tail_num].x, &tails[imgui_tail_num].y, &tails[imgui_tail_num].prev_x, &tails[imgui_tail_num].prev_y };
+Vec2i imgui_tail_tile;
+Vec2i imgui_board_size = new_vec2i(SIM_DEFAULT_BOARD_WIDTH, SIM_DEFAULT_BOARD_HEIGHT);
 int imgui_swap_interval = 1;
+bool imgui_real_time_mode = false;
+int imgui_tick_rate_hz = TICK_RATE_DEFAULT_HZ;
+u64 imgui_history_frame = 0;
 
 int main(int arguments_count, char **arguments) {
     ZoneScoped;
     
-    srand(time(NULL)); // Init random number generator seed
+    log_start(GAME_LOG_PATH, GAME_LOG_CONSOLE_LEVEL);
+    open_game_replay();
+    sim_rng_seed(&seed_rng, (u64)time(NULL), 0); // Init random number generator seed
+    log_events = open_game_event_stream();
+
+    // Usage: snake [board width] [board height]
+    if (arguments_count >= 3) {
+        board_size.x = atoi(arguments[1]);
+        board_size.y = atoi(arguments[2]);
+        imgui_board_size = board_size;
+    }
 
     init_renderer();
 
     // Init defaults.
-    // player.model = glm::scale(player.model, glm::vec3(TILE_SCALING_FACTOR));
-    // resource.model = glm::scale(resource.model, glm::vec3(TILE_SCALING_FACTOR));
-    player.tails = tails;
-    player.model = glm::scale(player.model, glm::vec3(100.0f));
-    resource.model = player.model;
-
-    For (PLAYER_TAIL_LENGTH_MAX) {
-        tails[it].model = player.model;
+    if (!resize_game_board(board_size.x, board_size.y)) {
+        LOG_WARNING("Couldn't make a %dx%d board, falling back to %dx%d.", board_size.x, board_size.y, SIM_DEFAULT_BOARD_WIDTH, SIM_DEFAULT_BOARD_HEIGHT);
+        board_size = new_vec2i(SIM_DEFAULT_BOARD_WIDTH, SIM_DEFAULT_BOARD_HEIGHT);
+        resize_game_board(board_size.x, board_size.y);
     }
+    game_reset(get_new_game_seed());
+    publish_game_snapshot();
+    game_snapshot = triple_buffer_acquire(&snapshots);
 
     game_state = TITLE_SCREEN;
     // draw_all_tails_on_screen();
 
+    // Game runs on its own thread from here on, this one only draws whatever
+    // it published last and sends it commands.
+    start_sim_thread();
+
     while (!glfwWindowShouldClose(window)) {
-        // !!!
-        // We already do this in 'game_tick()'
-        // !!!
-        //
-        //
-        //
-        make_tails_color_linear_gradient(tails, PLAYER_TAIL_LENGTH_MAX, player.color, player.last_tail_color, 0.0f);
+        game_snapshot = triple_buffer_acquire(&snapshots);
+        print_game_events();
+        update_tails_color_gradient();
 
         // process_input(window);
 
         // Move player or resource when "Move" button pressed.
+        // Player walks there square by square, so its tails stay connected.
         if (imgui_states[MOVE_PLAYER_BUTTON_PRESSED]) {
-            move_player(&player, player_move.x, player_move.y);
+            Game_Command command = {};
+            command.kind = GAME_COMMAND_WALK_PLAYER;
+            command.tile = player_move;
+            push_game_command(command);
         } else if (imgui_states[MOVE_RESOURCE_BUTTON_PRESSED]) {
-            move_resource_from_origin(&resource, resource_move.x, resource_move.y);
+            Game_Command command = {};
+            command.kind = GAME_COMMAND_MOVE_RESOURCE;
+            command.tile = resource_move;
+            push_game_command(command);
+        } else if (imgui_states[RESIZE_BOARD_BUTTON_PRESSED]) {
+            restart_game_on_board(imgui_board_size);
+        } else if (imgui_states[LOAD_SESSION_BUTTON_PRESSED]) {
+            load_session();
+        } else if (imgui_states[VERIFY_SAVE_BUTTON_PRESSED]) {
+            verify_session();
         }
 
+        sim_playing.store((game_state & PLAY) && !(game_state & PAUSE_SCREEN), std::memory_order_relaxed);
+
         renderer_draw(game_state);
     }
 
@@ -91,299 +192,789 @@ int main(int arguments_count, char **arguments) {
     exit(EXIT_SUCCESS);
 }
 
-void game_tick() {
+// Simulation thread only (or main thread while it's stopped), same for
+// everything that ends up calling it. What happened goes out as events.
+void game_tick(Sim_Input input) {
     ZoneScoped;
-    
-    bool player_on_resource_tile = floats_equal(player.x, resource.x) && floats_equal(player.y, resource.y);
 
-    bool player_on_tail_tile = false;
-    For (player.tail_length) {
-        if (player_on_tail_tile) break;
-        player_on_tail_tile = floats_equal(player.x, player.tails[it].x) && floats_equal(player.y, player.tails[it].y);
+    if (replay_edited) {
+        // Once for however many edits came before, dragging a tile is one every frame.
+        replay_edited = false;
+        sim_replay_begin_edited_game(&replay, sim);
     }
-
-    if (player_on_tail_tile) {
-        game_over();
-        game_reset();
+    u32 events = sim_step(sim, input);
+    sim_history_record_tick(&history, sim, input);
+    sim_replay_record_input(&replay, sim, input);
+    ZoneValue(sim->player.tail_length + 1);
+    TracyPlot("Player length", (int64_t)(sim->player.tail_length + 1));
+    stats.moves = sim->moves;
+    stats.score = sim->score;
+    snapshot_dirty = true;
+
+    if (events & SIM_EVENT_RESOURCE_PICKED) {
+        emit_game_event(GAME_EVENT_RESOURCE_PICKED, sim->player.head);
     }
-
-    if (player_on_resource_tile) {
-        printf("[%.2f] - Player stepped on resource tile at [%.1f, %.1f]\n", frametime.current, player.x, player.y); 
-        move_resource_to_rand_pos(&resource, &player);
-        stats.score++;
-        player.tail_length++;
+    if (events & (SIM_EVENT_DIED | SIM_EVENT_WON)) {
+        emit_game_event((events & SIM_EVENT_WON) ? GAME_EVENT_WON : GAME_EVENT_DIED, sim->player.head);
+        sim_replay_end_game(&replay, sim, (events & SIM_EVENT_WON) ? SIM_REPLAY_END_WON : SIM_REPLAY_END_DIED);
+        game_over();
+        game_reset(get_new_game_seed());
     }
-    move_player_tails(&player);
-    make_tails_color_linear_gradient(tails, PLAYER_TAIL_LENGTH_MAX, player.color, player.last_tail_color, 0.0f);
 }
 
-void game_reset() {
+void game_reset(u64 seed) {
     ZoneScoped;
     
     // Reset statistics.
-    stats.start_time = frametime.current;
+    stats.start_time = (float)glfwGetTime();
     stats.current_time = 0.0f;
     stats.moves = 0;
     stats.score = 0;
 
-    float dx, dy;
-    // Reset tails.
-    For (player.tail_length) {
-        dx = -tails[it].x;
-        dy = -tails[it].y;
-        tails[it].x = 0.0f;
-        tails[it].y = 0.0f;
-        tails[it].prev_x = 0.0f;
-        tails[it].prev_y = 0.0f;
-        tails[it].model = glm::translate(tails[it].model, glm::vec3(dx, dy, 0.0f));
-    }
-
-    // Reset player.
-    player.tail_length = 0;
-    dx = -player.x;
-    dy = -player.y;
-    player.x = 0.0f;
-    player.y = 0.0f;
-    player.prev_x = 0.0f;
-    player.prev_y = 0.0f;
-    player.model = glm::translate(player.model, glm::vec3(dx, dy, 0.0f));
-    printf("[%.2f] - Game has been reseted.\n", frametime.current);
-
-    // Reset resource. (move to new random tile)
-    move_resource_to_rand_pos(&resource, &player);
+    // Game being replaced ends here, while 'sim' still has where it got to.
+    sim_replay_end_game(&replay, sim, SIM_REPLAY_END_ABANDONED);
+
+    // Reset player, its tails and resource (moves to new random tile).
+    // In real-time mode player stands still until the first key press.
+    sim_reset(sim, seed);
+    sim_history_record_change(&history, sim);
+    sim_replay_begin_game(&replay, sim);
+    replay_edited = false;
+    heading = SIM_INPUT_NONE;
+    turn_count = 0;
+    tick_accumulator = 0.0;
+    snapshot_dirty = true;
+    emit_game_event(GAME_EVENT_RESET, sim->player.head);
+}
+
+// Main thread. New game starts once the simulation thread gets to it.
+void request_game_reset() {
+    Game_Command command = {};
+    command.kind = GAME_COMMAND_RESET;
+    push_game_command(command);
+}
+
+// Main thread. Frame is clamped to what the history still has when it's applied.
+void seek_game_history(u64 frame) {
+    Game_Command command = {};
+    command.kind = GAME_COMMAND_SEEK_HISTORY;
+    command.frame = frame;
+    push_game_command(command);
+}
+
+// Main thread, before the simulation thread starts. The dictionary is
+// optional, replays without one come out a bit bigger.
+void open_game_replay() {
+    ZoneScoped;
+
+    u8 *dictionary = NULL;
+    long dictionary_size = 0;
+    FILE *file = fopen(GAME_REPLAY_DICTIONARY_PATH, "rb");
+    if (file) {
+        fseek(file, 0, SEEK_END);
+        dictionary_size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        dictionary = (dictionary_size > 0) ? (u8 *) malloc((size_t)dictionary_size) : NULL;
+        if (dictionary && fread(dictionary, 1, (size_t)dictionary_size, file) != (size_t)dictionary_size) {
+            free(dictionary);
+            dictionary = NULL;
+        }
+        fclose(file);
+    }
+
+    // Named after when the session started, with a number after it when that's taken.
+    char name[64];
+    char path[80];
+    time_t now = time(NULL);
+    strftime(name, sizeof(name), GAME_REPLAY_NAME_FORMAT, localtime(&now));
+    snprintf(path, sizeof(path), "%s%s", name, GAME_REPLAY_EXTENSION);
+    for (int number = 2; (file = fopen(path, "rb")) != NULL; number++) {
+        fclose(file);
+        snprintf(path, sizeof(path), "%s_%d%s", name, number, GAME_REPLAY_EXTENSION);
+    }
+
+    if (!sim_replay_open(&replay, path, GAME_REPLAY_COMPRESSION_LEVEL, dictionary, dictionary ? dictionary_size : 0)) {
+        LOG_WARNING("Couldn't create the replay file, this session won't be recorded.");
+    } else if (dictionary) {
+        LOG_INFO("Recording replays with the %ld-byte dictionary.", dictionary_size);
+    }
+    free(dictionary);
+}
+
+// Before the state changes other than by a tick.
+static void end_game_replay_for_edit() {
+    sim_replay_end_game(&replay, sim, SIM_REPLAY_END_EDITED);
+    replay_edited = true;
+}
+
+// Main thread only. Board storage can't change under the simulation thread,
+// so it's stopped until the new board has its first snapshot.
+void restart_game_on_board(Vec2i size) {
+    ZoneScoped;
+
+    stop_sim_thread();
+    sim_replay_end_game(&replay, sim, SIM_REPLAY_END_ABANDONED);
+
+    // Failed resize may have reused the arena 'sim' was in, so the old size is kept aside.
+    Vec2i old_size = new_vec2i(sim->width, sim->height);
+    board_size = size;
+    if (!resize_game_board(board_size.x, board_size.y)) {
+        LOG_WARNING("Couldn't make a %dx%d board, keeping %dx%d.", board_size.x, board_size.y, old_size.x, old_size.y);
+        board_size = old_size;
+        resize_game_board(board_size.x, board_size.y);
+    }
+    game_reset(get_new_game_seed());
+
+    // Snapshot the main thread held points at storage that was just reused,
+    // so it has to switch to the new board before drawing again.
+    publish_game_snapshot();
+    game_snapshot = triple_buffer_acquire(&snapshots);
+
+    start_sim_thread();
+}
+
+// Takes simulation storage, the save copy, history, snapshot tiles and render-side
+// tails for a board from 'board_arena', growing it when needed. Game has to be reset
+// after this, with the simulation thread stopped.
+bool resize_game_board(int width, int height) {
+    ZoneScoped;
+
+    // Save being written reads from this arena.
+    wait_for_game_save();
+
+    if (width < SIM_BOARD_SIDE_MIN || width > SIM_BOARD_SIDE_MAX ||
+        height < SIM_BOARD_SIDE_MIN || height > SIM_BOARD_SIDE_MAX) {
+        return false;
+    }
+
+    u64 tails_count = (u64)width * (u64)height;
+    u64 snapshot_tiles_size = tails_count * sizeof(u32);
+    u32 history_keyframes = (u32)glm::min(HISTORY_MEMORY_BUDGET / sim_get_state_size(width, height), (u64)HISTORY_KEYFRAMES_MAX);
+    if (history_keyframes < 2) {
+        history_keyframes = 0;
+    }
+    u64 needed = 2 * sim_get_memory_size(width, height) + tails_count * sizeof(Tail) +
+                 sim_history_get_memory_size(width, height, history_keyframes, HISTORY_KEYFRAME_INTERVAL) +
+                 ArrayCount(snapshots.buffers) * snapshot_tiles_size + 64 * (1 + ArrayCount(snapshots.buffers));
+    if (board_arena.capacity < needed) {
+        free_memory_arena(&board_arena);
+        board_arena = alloc_memory_arena(needed);
+        if (!board_arena.data) {
+            LOG_ERROR("Couldn't allocate memory for memory arena!");
+            return false;
+        }
+    }
+    clear_memory_arena(&board_arena);
+
+    sim = sim_init(&board_arena, width, height);
+    save_state = sim_init(&board_arena, width, height);
+    if (!sim || !save_state || !sim_history_init(&history, &board_arena, width, height, history_keyframes, HISTORY_KEYFRAME_INTERVAL)) {
+        return false;
+    }
+    tails = (Tail *) push_memory_arena(&board_arena, tails_count * sizeof(Tail));
+    tails_capacity = (int)tails_count;
+    tails_gradient_valid = false;
+    For (tails_capacity) {
+        tails[it] = Tail();
+    }
+    player.tails = tails;
+
+    For (ArrayCount(snapshots.buffers)) {
+        snapshots.buffers[it].tiles = (u32 *) push_memory_arena(&board_arena, snapshot_tiles_size);
+    }
+
+    LOG_INFO("Board is now %dx%d tiles. (%.2f MB)", width, height, board_arena.size / (1024.0 * 1024.0));
+    return true;
+}
+
+u64 get_new_game_seed() {
+    u64 high = sim_rng_next(&seed_rng);
+    u64 low = sim_rng_next(&seed_rng);
+    return (high << 32) | low;
 }
 
 void game_over() {
     ZoneScoped;
     
-    stats.current_time = frametime.current;
-    printf("[%.2f] - Game over! End result - Score: %d, Time: %.3f, Moves: %d\n", frametime.current, stats.score, stats.current_time - stats.start_time, stats.moves);
+    stats.current_time = (float)glfwGetTime();
 }
 
+// Save thread. Writes out the copy 'start_game_save()' took.
+static void write_game_save() {
+    ZoneScoped;
+    tracy::SetThreadName("Save");
+
+    u64 start = log_get_time_ns();
+    Sim_Compressor compressor;
+    bool compressed = GAME_SAVE_COMPRESSION_LEVEL > 0 && sim_init_compressor(&compressor, GAME_SAVE_COMPRESSION_LEVEL, NULL, 0);
+    u32 result = sim_write_save(GAME_SAVE_PATH, save_state, compressed ? &compressor : NULL);
+    if (compressed) {
+        sim_free_compressor(&compressor);
+    }
+    if (result == SIM_SAVE_OK) {
+        LOG_INFO("Game saved. (%.2f MB in %.2f ms)", save_state->size / (1024.0 * 1024.0), (log_get_time_ns() - start) / 1e6);
+    } else {
+        LOG_ERROR("Couldn't save the game. (error %u)", result);
+    }
+    save_writing.store(false, std::memory_order_release);
+}
+
+// Simulation thread only (or main thread while it's stopped). The game only
+// pays for one 'sim_copy_state()', the file is written on a thread of its
+// own. Skipped while the previous save is still being written.
+static void start_game_save() {
+    ZoneScoped;
+
+    if (save_writing.load(std::memory_order_acquire)) {
+        LOG_WARNING("Previous save is still being written, skipping this one.");
+        return;
+    }
+    if (save_thread.joinable()) {
+        save_thread.join(); // Already done, 'save_writing' was cleared.
+    }
+    sim_copy_state(save_state, sim);
+    save_writing.store(true, std::memory_order_release);
+    save_thread = std::thread(write_game_save);
+}
+
+// Main thread only, with the simulation thread stopped.
+void wait_for_game_save() {
+    if (save_thread.joinable()) {
+        save_thread.join();
+    }
+}
+
+// Main thread only, with the simulation thread stopped. Returns once the file is written.
 void game_save() {
     ZoneScoped;
     
-    printf("[UNIMPLEMENTED] [%.2f] - Saving game session...\n", frametime.current);
+    start_game_save();
+    wait_for_game_save();
+}
+
+// Main thread. Game is saved at the simulation thread's next update, without waiting for it.
+void save_session() {
+    Game_Command command = {};
+    command.kind = GAME_COMMAND_SAVE;
+    push_game_command(command);
+}
+
+// Main thread only, with the simulation thread stopped. Maps the save and
+// takes the game from it, switching boards when it was saved on another size.
+// Current game stays as it was when there's no save or it can't be used.
+// Header and state layout are checked, the checksum of the whole block is
+// left to 'verify_session()' so big boards load without reading it twice.
+bool load_game_save() {
+    ZoneScoped;
+
+    wait_for_game_save();
+
+    Sim_Save_Mapping mapping;
+    u32 result = sim_map_save(GAME_SAVE_PATH, &mapping, false);
+    if (result != SIM_SAVE_OK) {
+        LOG_WARNING("Couldn't load the saved game. (error %u)", result);
+        return false;
+    }
+    end_game_replay_for_edit();
+
+    Vec2i size = new_vec2i(mapping.state->width, mapping.state->height);
+    if (size.x != sim->width || size.y != sim->height) {
+        Vec2i old_size = new_vec2i(sim->width, sim->height);
+        if (!resize_game_board(size.x, size.y)) {
+            LOG_WARNING("Couldn't make a %dx%d board for the saved game, keeping %dx%d.", size.x, size.y, old_size.x, old_size.y);
+            sim_unmap_save(&mapping);
+            // Failed resize may have reused the arena, so the old game is gone either way.
+            resize_game_board(old_size.x, old_size.y);
+            game_reset(get_new_game_seed());
+            return false;
+        }
+        board_size = size;
+        imgui_board_size = size;
+    }
+
+    sim_copy_state(sim, mapping.state);
+    sim_unmap_save(&mapping);
+
+    sim_history_record_change(&history, sim);
+    heading = SIM_INPUT_NONE;
+    turn_count = 0;
+    tick_accumulator = 0.0;
+    stats.moves = sim->moves;
+    stats.score = sim->score;
+    snapshot_dirty = true;
+    LOG_INFO("Game loaded. (%dx%d board, score: %d, moves: %d)", sim->width, sim->height, sim->score, sim->moves);
+    return true;
+}
+
+// Main thread only. Board storage can change, so the simulation thread is
+// stopped until the loaded game has its first snapshot.
+void load_session() {
+    ZoneScoped;
+
+    stop_sim_thread();
+    if (load_game_save()) {
+        game_state &= ~(TITLE_SCREEN | PAUSE_SCREEN);
+        game_state |= PLAY;
+    }
+    publish_game_snapshot();
+    game_snapshot = triple_buffer_acquire(&snapshots);
+    start_sim_thread();
+}
+
+// Main thread only. Checks the whole save against its checksum, with the
+// simulation thread stopped so a save being written is finished first.
+void verify_session() {
+    ZoneScoped;
+
+    stop_sim_thread();
+    wait_for_game_save();
+    Sim_Save_Mapping mapping;
+    u32 result = sim_map_save(GAME_SAVE_PATH, &mapping, true);
+    if (result == SIM_SAVE_OK) {
+        LOG_INFO("Saved game is intact. (%dx%d board, score: %d, moves: %d)", mapping.state->width, mapping.state->height,
+                 mapping.state->score, mapping.state->moves);
+        sim_unmap_save(&mapping);
+    } else {
+        LOG_WARNING("Saved game can't be used. (error %u)", result);
+    }
+    start_sim_thread();
 }
 
 void game_exit() {
     ZoneScoped;
     
-    printf("[%.2f] - Exiting from game...\n", frametime.current);
+    LOG_INFO("Exiting from game...");
+    stop_sim_thread();
     if (game_state & PLAY) {
         game_save();
     }
+    sim_replay_end_game(&replay, sim, SIM_REPLAY_END_ABANDONED);
+    sim_replay_close(&replay);
+    LOG_INFO("Recorded %llu games, %llu ticks in %llu bytes.", replay.games, replay.ticks, replay.bytes);
+    wait_for_game_save();
     renderer_free_resources();
+    log_stop();
     exit(EXIT_SUCCESS);
 }
 
 void store_stats(Stats *stats) {
     ZoneScoped;
     
-    printf("[UNIMPLEMENTED] [%.2f] - Saving statistics...\n", frametime.current);
+    LOG_INFO("[UNIMPLEMENTED] Saving statistics...");
 }
 
-// squares_right - how many square spaces move right (if positive)
-// or left (if negative)
-// squrers_up    - how many square spaces move up (if positive)
-// or down (if negative)
-void move_player(Player *player, int squares_right, int squares_up) {
+// --- Simulation thread ---
+
+static void make_game_snapshot(Game_Snapshot *snapshot) {
     ZoneScoped;
-    
-    // Actually it's '1 * squares_right', because square length is 1.
-    // But it's unnecessary because '1 * squares_right' == 'squres_right'.
-    float dx = 1.2f * squares_right;
-    float dy = 1.2f * squares_up;
-    player->prev_x = player->x;
-    player->prev_y = player->y;
-    player->x += dx;
-    player->y += dy;
-    player->model = glm::translate(player->model, glm::vec3(dx, dy, 0));
 
-    stats.moves++;
-    game_tick();
+    snapshot->width = sim->width;
+    snapshot->height = sim->height;
+    snapshot->resource = sim->resource;
+    snapshot->length = sim->player.tail_length + 1;
+    snapshot->tiles[0] = sim_get_head(sim);
+    For (sim->player.tail_length) {
+        snapshot->tiles[it + 1] = sim_get_tail(sim, it);
+    }
+    snapshot->score = sim->score;
+    snapshot->moves = sim->moves;
+    snapshot->tick = sim->tick;
+    snapshot->seed = sim->seed;
+    snapshot->hash = sim->hash;
+    snapshot->input_stats = input_stats;
+
+    History_Stats *history_stats = &snapshot->history;
+    history_stats->first_frame = history.first_frame;
+    history_stats->last_frame = history.last_frame;
+    history_stats->frame = history.current_frame;
+    history_stats->keyframes = history.keyframes_count;
+    history_stats->keyframes_capacity = history.keyframes_capacity;
+    history_stats->memory_used = sim_history_get_memory_used(&history);
+    history_stats->memory_capacity = history.keyframes_capacity * history.state_size + history.inputs_capacity;
+}
+
+// Simulation thread only (or main thread while it's stopped).
+void publish_game_snapshot() {
+    make_game_snapshot(triple_buffer_back(&snapshots));
+    triple_buffer_publish(&snapshots);
+    snapshot_dirty = false;
 }
 
-void move_resource_from_origin(Resource *resource, int squares_right, int squares_up) {
-    ZoneScoped;
-    
-    // Move it to origin first, which is [0.0, 0.0].
-    float dx = -resource->x;
-    float dy = -resource->y;
-    resource->x = 0.0f;
-    resource->y = 0.0f;
-    resource->model = glm::translate(resource->model, glm::vec3(dx, dy, 0));
+// Runs ticks as they come due and publishes what changed. Sleeps in between,
+// at most 'SIM_THREAD_IDLE_SECONDS' so new commands don't wait for long.
+static void run_sim_thread() {
+    tracy::SetThreadName("Simulation");
 
-    // And then translate to a new position.
-    dx = 1.2f * squares_right;
-    dy = 1.2f * squares_up;
-    resource->x += dx;
-    resource->y += dy;
-    resource->model = glm::translate(resource->model, glm::vec3(dx, dy, 0));
+    while (sim_thread_running.load(std::memory_order_acquire)) {
+        update_game_ticks(glfwGetTime());
+        if (snapshot_dirty) {
+            publish_game_snapshot();
+        }
 
-    printf("[%.2f] - Resource moved to [%.1f, %.1f]\n", frametime.current, resource->x, resource->y);
+        double sleep_seconds = SIM_THREAD_IDLE_SECONDS;
+        if (real_time_mode.load(std::memory_order_relaxed) && (heading != SIM_INPUT_NONE || turn_count > 0)) {
+            double tick_seconds = 1.0 / (double)tick_rate_hz.load(std::memory_order_relaxed);
+            sleep_seconds = glm::min(sleep_seconds, tick_seconds - tick_accumulator);
+        }
+        if (sleep_seconds > 0.0) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(sleep_seconds));
+        }
+    }
 }
 
+// Main thread only.
+void start_sim_thread() {
+    tick_last_update_time = glfwGetTime();
+    sim_thread_running.store(true, std::memory_order_release);
+    sim_thread = std::thread(run_sim_thread);
+}
 
-void move_resource_to_rand_pos(Resource *resource, Player *player) {
-    ZoneScoped;
-    
-    Vec2f new_pos;
-    Vec2f check_pos;
-    {
-    rand:
-        new_pos = new_random_pos(PLAYABLE_AREA_HEIGHT, PLAYABLE_AREA_LENGTH);
-        // Make sure we don't move to the same position.
-        check_pos.x = resource->x;
-        check_pos.y = resource->y;
-        bool on_not_valid_tile = vec2f_equal(new_pos, check_pos);
-        if (on_not_valid_tile) {
-            printf("[%.2f] - New resource position is on old resource's position! New iteration...\n", frametime.current);
-            goto rand;
-        }
+// Main thread only. Returns once the simulation thread is done with its
+// current update, commands still in the queue wait for the next start.
+void stop_sim_thread() {
+    if (!sim_thread.joinable()) {
+        return;
+    }
+    sim_thread_running.store(false, std::memory_order_release);
+    sim_thread.join();
+}
+
+// Main thread only.
+void push_game_command(Game_Command command) {
+    if (!spsc_push(&command_queue, command)) {
+        commands_dropped++;
+    }
+}
 
-        // We don't need to check the player's tile
-        // because its position always should be the same as the resource's one.
-
-        // Since we first calculate new resource position and only then
-        // move the player's tail, we need to check previous player position
-        // because the tail didn't go forward yet. 
-        check_pos.x = player->prev_x;
-        check_pos.y = player->prev_y;
-        on_not_valid_tile = vec2f_equal(new_pos, check_pos);
-        if (on_not_valid_tile) {
-            printf("[%.2f] - New resource position is on player's previous tile! New iteration...\n", frametime.current);
-            goto rand;
+// Any thread. Returns NULL when every stream is taken. Events sent
+// before a stream was opened don't show up in it.
+Game_Event_Stream *open_game_event_stream() {
+    For (GAME_EVENT_STREAMS_MAX) {
+        bool closed = false;
+        if (game_event_streams[it].open.compare_exchange_strong(closed, true, std::memory_order_acq_rel)) {
+            return &game_event_streams[it];
         }
+    }
+    return NULL;
+}
 
-        For (player->tail_length) {
-            check_pos.x = player->tails[it].x;
-            check_pos.y = player->tails[it].y;
-            on_not_valid_tile = vec2f_equal(new_pos, check_pos);
-            if (on_not_valid_tile) {
-                printf("[%.2f] - New resource position is on player's %d-th tail tile! New iteration...\n", frametime.current, it+1);
-                goto rand;
-            }
+// Only from the one thread that consumes 'stream'.
+bool pop_game_event(Game_Event_Stream *stream, Game_Event *event) {
+    return spsc_pop(&stream->queue, event);
+}
+
+// Simulation thread only (or main thread while it's stopped). Never waits,
+// a stream that's full just misses this event.
+void emit_game_event(u32 kind, Vec2i tile) {
+    Game_Event event;
+    event.kind = kind;
+    event.tick = sim->tick;
+    event.tile = tile;
+    event.score = sim->score;
+    event.moves = sim->moves;
+    event.seed = sim->seed;
+    event.time = glfwGetTime();
+
+    For (GAME_EVENT_STREAMS_MAX) {
+        Game_Event_Stream *stream = &game_event_streams[it];
+        if (!stream->open.load(std::memory_order_acquire)) {
+            continue;
+        }
+        if (!spsc_push(&stream->queue, event)) {
+            stream->dropped.fetch_add(1, std::memory_order_relaxed);
         }
     }
+}
 
-    // Divide it by 1.2f so it is represented in squares.
-    move_resource_from_origin(resource, new_pos.x / 1.2f, new_pos.y / 1.2f);
+// Main thread only. Game log is one of the event consumers, drained into the logger once per frame.
+void print_game_events() {
+    if (!log_events) {
+        return;
+    }
+
+    Game_Event event;
+    while (pop_game_event(log_events, &event)) {
+        switch (event.kind) {
+            case GAME_EVENT_RESET: {
+                log_game_start_time = event.time;
+                LOG_INFO("Game has been reseted. (seed: %llu)", event.seed);
+            } break;
+            case GAME_EVENT_RESOURCE_PICKED: {
+                LOG_INFO("Player stepped on resource tile at [%d, %d]", event.tile.x, event.tile.y);
+            } break;
+            case GAME_EVENT_RESOURCE_MOVED: {
+                LOG_INFO("Resource moved to [%d, %d]", event.tile.x, event.tile.y);
+            } break;
+            case GAME_EVENT_DIED:
+            case GAME_EVENT_WON: {
+                if (event.kind == GAME_EVENT_WON) {
+                    LOG_INFO("Player filled the whole playable area!");
+                }
+                LOG_INFO("Game over! End result - Score: %d, Time: %.3f, Moves: %d", event.score,
+                         event.time - log_game_start_time, event.moves);
+            } break;
+        }
+    }
 }
 
-//@Copy of 'move_player'
-void move_tail(Tail *tail, int squares_right, int squares_up) {
+// Called from the key callback. Only queues the key press, the game reacts
+// to it at the next tick boundary in 'update_game_ticks()'.
+void move_player(Sim_Input input) {
     ZoneScoped;
-    
-    float dx = 1.2f * squares_right;
-    float dy = 1.2f * squares_up;
-    tail->prev_x = tail->x;
-    tail->prev_y = tail->y;
-    tail->x += dx;
-    tail->y += dy;
-    tail->model = glm::translate(tail->model, glm::vec3(dx, dy, 0));
+
+    Game_Command command = {};
+    command.kind = GAME_COMMAND_INPUT;
+    command.event.input = input;
+    command.event.time = glfwGetTime();
+    push_game_command(command);
 }
 
-void move_player_tails(Player *player) {
-    ZoneScoped;
-    
-    Tail *tails = player->tails;
-
-    // Tail #0
-    float tx = tails[0].x;
-    float ty = tails[0].y;
-    float dx = player->prev_x - tx;
-    float dy = player->prev_y - ty;
-    tails[0].prev_x = tx;
-    tails[0].prev_y = ty;
-    tails[0].x += dx;
-    tails[0].y += dy;
-    tails[0].model = glm::translate(tails[0].model, glm::vec3(dx, dy, 0.0f));
-
-    // Tail #1..#tail_length-1
-    for (int it = 1; it < player->tail_length; it++) {
-        float tx = tails[it].x;
-        float ty = tails[it].y;
-        float dx = tails[it-1].prev_x - tx;
-        float dy = tails[it-1].prev_y - ty;
-        tails[it].prev_x = tx;
-        tails[it].prev_y = ty;
-        tails[it].x += dx;
-        tails[it].y += dy;
-        tails[it].model = glm::translate(tails[it].model, glm::vec3(dx, dy, 0.0f));
-    }
-}
-
-Vec2f new_random_pos(int squares_up_max, int squares_right_max) {
-    ZoneScoped;
-    
-    Vec2f result;
-    // Values on Y axis: [-squares_up_max,    squares_up_max]
-    // Values on X axis: [-squares_right_max, squares_right_max]
-
-    // First, we generate number in interval [x, 2*x]
-    // and then substract 'x', so interval would be [-x, x]
-    int temprand = rand() % ((2*squares_right_max)+1);
-    result.x = (float) (temprand - squares_right_max) * 1.2f;
-    temprand = rand() % ((2*squares_up_max)+1);
-    result.y = (float) (temprand - squares_up_max) * 1.2f;
-    return result;
-};
+static void record_input_latency(double latency) {
+    if (input_stats.applied == 0) {
+        input_stats.latency_min = latency;
+        input_stats.latency_max = latency;
+    }
+    input_stats.applied++;
+    input_stats.latency_min = glm::min(input_stats.latency_min, latency);
+    input_stats.latency_max = glm::max(input_stats.latency_max, latency);
+    input_stats.latency_total += latency;
+    TracyPlot("Input latency (ms)", latency * 1000.0);
+}
+
+// Real-time mode turns are checked against the last buffered one, so quick
+// Up, Left while heading Right is kept and Right, Left is not.
+static void buffer_turn(Input_Event event) {
+    Sim_Input last = (turn_count > 0) ? turn_buffer[turn_count - 1].input : heading;
+    if (event.input == last) {
+        return;
+    }
+    if (sim->player.tail_length > 0 && sim_is_reversal(last, event.input)) {
+        input_stats.dropped_reversals++;
+        return;
+    }
+    if (turn_count == TURN_BUFFER_CAPACITY) {
+        input_stats.dropped_overflow++;
+        return;
+    }
+    turn_buffer[turn_count++] = event;
+}
+
+static void apply_next_turn(double now) {
+    if (turn_count == 0) {
+        return;
+    }
+
+    Input_Event event = turn_buffer[0];
+    turn_count--;
+    For (turn_count) {
+        turn_buffer[it] = turn_buffer[it + 1];
+    }
 
-Vec2f new_random_resource_pos(Resource *resource, int max_tile_x, int max_tile_y, Vec2f *not_valid_tiles, int tiles_size) {
+    heading = event.input;
+    record_input_latency(now - event.time);
+}
+
+static void apply_game_command(Game_Command command) {
+    switch (command.kind) {
+        case GAME_COMMAND_RESET: {
+            game_reset(get_new_game_seed());
+        } break;
+        case GAME_COMMAND_WALK_PLAYER: {
+            For (abs(command.tile.x)) {
+                game_tick((command.tile.x > 0) ? SIM_INPUT_RIGHT : SIM_INPUT_LEFT);
+            }
+            For (abs(command.tile.y)) {
+                game_tick((command.tile.y > 0) ? SIM_INPUT_UP : SIM_INPUT_DOWN);
+            }
+        } break;
+        case GAME_COMMAND_MOVE_RESOURCE: {
+            end_game_replay_for_edit();
+            move_resource_from_origin(command.tile.x, command.tile.y);
+            sim_history_record_change(&history, sim);
+        } break;
+        // Body parts can't be moved onto each other, the player would lose a tile.
+        case GAME_COMMAND_SET_PLAYER_TILE: {
+            u32 *head = &sim_get_body(sim)[sim->player.body_head];
+            if (sim_tile_in_bounds(sim, command.tile) &&
+                (*head == sim_tile_index(sim, command.tile) || !sim_tile_occupied(sim, sim_tile_index(sim, command.tile)))) {
+                end_game_replay_for_edit();
+                sim->player.head = command.tile;
+                *head = sim_tile_index(sim, command.tile);
+                sim_rebuild_occupancy(sim);
+                sim_history_record_change(&history, sim);
+            }
+        } break;
+        case GAME_COMMAND_SET_RESOURCE_TILE: {
+            if (sim_tile_in_bounds(sim, command.tile)) {
+                end_game_replay_for_edit();
+                sim_set_resource(sim, sim_tile_index(sim, command.tile));
+                sim_history_record_change(&history, sim);
+            }
+        } break;
+        case GAME_COMMAND_SET_TAIL_TILE: {
+            if (!sim_tile_in_bounds(sim, command.tile) || command.index < 0 || command.index >= sim->player.tail_length) {
+                break;
+            }
+            u32 *tail = &sim_get_body(sim)[(sim->player.body_head - 1 - command.index) & sim->player.body_mask];
+            if (*tail == sim_tile_index(sim, command.tile) || !sim_tile_occupied(sim, sim_tile_index(sim, command.tile))) {
+                end_game_replay_for_edit();
+                *tail = sim_tile_index(sim, command.tile);
+                sim_rebuild_occupancy(sim);
+                sim_history_record_change(&history, sim);
+            }
+        } break;
+        case GAME_COMMAND_RESET_INPUT_STATS: {
+            input_stats = Input_Stats();
+        } break;
+        case GAME_COMMAND_SAVE: {
+            start_game_save();
+        } break;
+        case GAME_COMMAND_SEEK_HISTORY: {
+            end_game_replay_for_edit();
+            if (sim_history_seek(&history, sim, command.frame)) {
+                // Player waits for a key press from there, same as after a reset.
+                heading = SIM_INPUT_NONE;
+                turn_count = 0;
+                tick_accumulator = 0.0;
+                stats.moves = sim->moves;
+                stats.score = sim->score;
+            }
+        } break;
+    }
+    snapshot_dirty = true;
+}
+
+// Drains queued commands and runs ticks for key presses. This is the only
+// place the game advances, so simulation work never happens inside event
+// polling. Other commands apply right away, in the order they were sent.
+//
+// Turn-based mode runs one tick per key press. Real-time mode runs as many
+// fixed-length ticks as the time since the last call covers, zero or more
+// per call, and takes at most one buffered turn per tick. Leftover time
+// carries over to the next call. Returns how many ticks were run.
+int update_game_ticks(double now) {
     ZoneScoped;
-    
-    Vec2f new_pos;
-    Vec2f check_pos;
-    rand:
-    new_pos = new_random_pos(max_tile_x, max_tile_y);
-    check_pos.x = resource->x;
-    check_pos.y = resource->y;
-    bool on_not_valid_tile = vec2f_equal(new_pos, check_pos);
-    if (on_not_valid_tile) {
-        printf("[%.2f] - New resource position is on old resource's position! New iteration...\n", frametime.current);
-        goto rand;
-    }
-
-    For (tiles_size) {
-        on_not_valid_tile = vec2f_equal(new_pos, not_valid_tiles[it]);
-        if (on_not_valid_tile) {
-            printf("[%.2f] - New resource position is invalid! New iteration...\n", frametime.current);
+
+    double elapsed = glm::min(now - tick_last_update_time, TICK_CATCH_UP_MAX_SECONDS);
+    tick_last_update_time = now;
+
+    bool playing = sim_playing.load(std::memory_order_relaxed);
+    bool real_time = real_time_mode.load(std::memory_order_relaxed);
+
+    int ticks = 0;
+    Game_Command command;
+    while (spsc_pop(&command_queue, &command)) {
+        if (command.kind != GAME_COMMAND_INPUT) {
+            apply_game_command(command);
+            continue;
+        }
+        if (!playing) {
+            continue;
+        }
+        if (real_time) {
+            buffer_turn(command.event);
+            continue;
+        }
+        if (sim_is_reversal(sim_get_heading(sim), command.event.input)) {
+            input_stats.dropped_reversals++;
+            snapshot_dirty = true;
+            continue;
         }
+        record_input_latency(now - command.event.time);
+        game_tick(command.event.input);
+        ticks++;
     }
-    return new_pos;
+
+    if (!playing) {
+        turn_count = 0;
+        tick_accumulator = 0.0;
+        return ticks;
+    }
+    if (!real_time) {
+        return ticks;
+    }
+    if (heading == SIM_INPUT_NONE && turn_count == 0) {
+        tick_accumulator = 0.0;
+        return ticks;
+    }
+
+    double tick_seconds = 1.0 / (double)tick_rate_hz.load(std::memory_order_relaxed);
+    tick_accumulator += elapsed;
+
+    while (tick_accumulator >= tick_seconds) {
+        tick_accumulator -= tick_seconds;
+        ticks++;
+
+        apply_next_turn(now);
+        game_tick(heading);
+        if (heading == SIM_INPUT_NONE) {
+            // Game was reset and waits for a key press again.
+            break;
+        }
+    }
+    TracyPlot("Ticks per update", (int64_t)ticks);
+    return ticks;
+}
+
+void move_resource_from_origin(int squares_right, int squares_up) {
+    ZoneScoped;
+    
+    sim_move_resource_from_origin(sim, squares_right, squares_up);
+    emit_game_event(GAME_EVENT_RESOURCE_MOVED, sim_index_tile(sim, sim->resource));
+}
+
+glm::mat4 get_tile_model(float x, float y) {
+    glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3(TILE_MODEL_SCALE));
+    return glm::translate(model, glm::vec3(x, y, 0.0f));
+}
+
+glm::mat4 get_tile_model(Vec2i tile) {
+    Vec2f coords = get_tile_coords(tile);
+    return get_tile_model(coords.x, coords.y);
+}
+
+// How much the scene has to be zoomed out so the whole board fits on screen.
+// 1.0 when it already fits.
+float get_board_zoom() {
+    float half_width = ((game_snapshot->width - 1) * 0.5f * TILE_SPACING + 0.5f) * TILE_MODEL_SCALE;
+    float half_height = ((game_snapshot->height - 1) * 0.5f * TILE_SPACING + 0.5f) * TILE_MODEL_SCALE;
+    float zoom_x = half_width / (float)screen.width;
+    float zoom_y = half_height / (float)screen.height;
+    return glm::max(1.0f, glm::max(zoom_x, zoom_y));
+}
+
+// Simulation tiles start in the bottom-left corner of the playable area,
+// while world coordinates have the center of the board at the origin.
+// Board size comes from the snapshot, these are for the main thread.
+
+Vec2i get_snapshot_tile(Game_Snapshot *snapshot, u32 index) {
+    return new_vec2i(index % (u32)snapshot->width, index / (u32)snapshot->width);
 }
 
 /*inline*/
 Vec2f get_tile_coords(int x, int y) {
     Vec2f result;
-    result.x = (float)x * (1.0f / TILE_SCALING_FACTOR);
-    result.y = (float)y * (1.0f / TILE_SCALING_FACTOR);
+    result.x = ((float)x - (game_snapshot->width - 1) * 0.5f) * TILE_SPACING;
+    result.y = ((float)y - (game_snapshot->height - 1) * 0.5f) * TILE_SPACING;
     return result;
 }
 
 /*inline*/
 Vec2f get_tile_coords(Vec2i tile) {
-    Vec2f result;
-    result.x = (float)tile.x * (1.0f / TILE_SCALING_FACTOR);
-    result.y = (float)tile.y * (1.0f / TILE_SCALING_FACTOR);
-    return result;
+    return get_tile_coords(tile.x, tile.y);
 }
 
 /*inline*/
 Vec2i get_coords_tile(float x, float y) {
     Vec2i result;
-    result.x = (int) (x / (1.0f / TILE_SCALING_FACTOR));
-    result.y = (int) (y / (1.0f / TILE_SCALING_FACTOR));
+    result.x = (int) floorf(x / TILE_SPACING + (game_snapshot->width - 1) * 0.5f + 0.5f);
+    result.y = (int) floorf(y / TILE_SPACING + (game_snapshot->height - 1) * 0.5f + 0.5f);
     return result;
 }
 
 /*inline*/
 Vec2i get_coords_tile(Vec2f coords) {
-    Vec2i result;
-    result.x = (int) (coords.x / (1.0f / TILE_SCALING_FACTOR));
-    result.y = (int) (coords.y / (1.0f / TILE_SCALING_FACTOR));
-    return result;
+    return get_coords_tile(coords.x, coords.y);
 }
 
 void make_tails_color_step_gradient(Tail *tails, int length, glm::vec3 start_color, float step_r, float step_g, float step_b) {
@@ -401,34 +992,42 @@ void make_tails_color_step_gradient(Tail *tails, int length, glm::vec3 start_col
 void make_tails_color_linear_gradient(Tail *tails, int length, glm::vec3 start_color, glm::vec3 end_color, float offset_from_middle) {
     ZoneScoped;
     
-    glm::vec3 new_color = start_color;
-    glm::vec3 steps;
-    steps.r = (end_color.r - start_color.r) / length;
-    steps.g = (end_color.g - start_color.g) / length;
-    steps.b = (end_color.b - start_color.b) / length;
-    new_color.r += steps.r + offset_from_middle;
-    new_color.g += steps.g + offset_from_middle;
-    new_color.b += steps.b + offset_from_middle;
-    tails[0].color = new_color;
-
-    ForFrom (length, 1) {
-        steps.r = (end_color.r - start_color.r) / length;
-        steps.g = (end_color.g - start_color.g) / length;
-        steps.b = (end_color.b - start_color.b) / length;
-        new_color.r += steps.r;
-        new_color.g += steps.g;
-        new_color.b += steps.b;
+    glm::vec3 steps = (end_color - start_color) / (float)length;
+    glm::vec3 new_color = start_color + glm::vec3(offset_from_middle);
+    For (length) {
+        new_color += steps;
         tails[it].color = new_color;
     }
 }
 
+// Main thread only. Cheap enough to call every frame, the gradient is only
+// remade after the board was resized or the player colors were edited.
+// Colors set on a single tail stay until then.
+void update_tails_color_gradient() {
+    if (tails_gradient_valid && tails_gradient_start == player.color && tails_gradient_end == player.last_tail_color) {
+        return;
+    }
+
+    make_tails_color_linear_gradient(tails, tails_capacity, player.color, player.last_tail_color, 0.0f);
+    tails_gradient_start = player.color;
+    tails_gradient_end = player.last_tail_color;
+    tails_gradient_valid = true;
+}
+
 void make_imgui_layout() {
     ZoneScoped;
     
-    imgui_taildrag[0] = &tails[imgui_tail_num].x;
-    imgui_taildrag[1] = &tails[imgui_tail_num].y;
-    imgui_taildrag[2] = &tails[imgui_tail_num].prev_x;
-    imgui_taildrag[3] = &tails[imgui_tail_num].prev_y;
+    // Edits go to the simulation thread as commands, they show up here
+    // once it publishes the next snapshot.
+    Game_Snapshot *snapshot = game_snapshot;
+    imgui_tail_num = glm::clamp(imgui_tail_num, 0, glm::max(snapshot->length - 2, 0));
+    imgui_player_tile = get_snapshot_tile(snapshot, snapshot->tiles[0]);
+    if (snapshot->resource != SIM_NO_RESOURCE) { // None after a win, the last tile stays.
+        imgui_resource_tile = get_snapshot_tile(snapshot, snapshot->resource);
+    }
+    if (snapshot->length > 1) { // Only 'tiles[0, length)' are written.
+        imgui_tail_tile = get_snapshot_tile(snapshot, snapshot->tiles[1 + imgui_tail_num]);
+    }
 
     if (imgui_states[DRAW_DEMO_WINDOW]) {
         ImGui::ShowDemoWindow(&imgui_states[DRAW_DEMO_WINDOW]);
@@ -436,9 +1035,10 @@ void make_imgui_layout() {
 
     if (imgui_states[DRAW_CONSTANTS_WINDOW]) {
         ImGui::Begin("Constants");
-        ImGui::Text("Playable area height: %d", PLAYABLE_AREA_HEIGHT);
-        ImGui::Text("Playable area length: %d", PLAYABLE_AREA_LENGTH);
-        ImGui::Text("Player tail length max: %d", PLAYER_TAIL_LENGTH_MAX);
+        ImGui::Text("Playable area width: %d", snapshot->width);
+        ImGui::Text("Playable area height: %d", snapshot->height);
+        ImGui::Text("Player tail length max: %d", tails_capacity);
+        ImGui::Text("Board memory: %.2f MB", board_arena.size / (1024.0 * 1024.0));
         ImGui::Text("Floats compare precision: %g", COMPARE_FLOAT_PRECISION);
         ImGui::End();
     }
@@ -455,18 +1055,84 @@ void make_imgui_layout() {
         ImGui::Checkbox("Constants Window", &imgui_states[DRAW_CONSTANTS_WINDOW]);
         ImGui::Checkbox("Globals Window", &imgui_states[DRAW_GLOBALS_WINDOW]);
         ImGui::InputInt("Swap interval", &imgui_swap_interval);
+        ImGui::Checkbox("Real-time mode", &imgui_real_time_mode);
+        real_time_mode.store(imgui_real_time_mode, std::memory_order_relaxed);
+        ImGui::SliderInt("Tick rate (Hz)", &imgui_tick_rate_hz, TICK_RATE_MIN_HZ, TICK_RATE_MAX_HZ, "%d", ImGuiSliderFlags_Logarithmic);
+        imgui_tick_rate_hz = glm::clamp(imgui_tick_rate_hz, TICK_RATE_MIN_HZ, TICK_RATE_MAX_HZ);
+        tick_rate_hz.store(imgui_tick_rate_hz, std::memory_order_relaxed);
+        Input_Stats *snapshot_input_stats = &snapshot->input_stats;
+        double latency_average = snapshot_input_stats->applied ? snapshot_input_stats->latency_total / snapshot_input_stats->applied : 0.0;
+        ImGui::Text("Input latency: avg %.2f ms, min %.2f ms, max %.2f ms (%llu inputs)", latency_average * 1000.0,
+                    snapshot_input_stats->latency_min * 1000.0, snapshot_input_stats->latency_max * 1000.0, (unsigned long long)snapshot_input_stats->applied);
+        ImGui::Text("Dropped inputs: %llu reversals, %llu overflow", (unsigned long long)snapshot_input_stats->dropped_reversals,
+                    (unsigned long long)(snapshot_input_stats->dropped_overflow + commands_dropped));
+        ImGui::SameLine();
+        if (ImGui::Button("Reset##input_stats")) {
+            Game_Command command = {};
+            command.kind = GAME_COMMAND_RESET_INPUT_STATS;
+            push_game_command(command);
+            commands_dropped = 0;
+        }
+        ImGui::Text("Dropped log events: %llu", (unsigned long long)(log_events ? log_events->dropped.load(std::memory_order_relaxed) : 0));
+        History_Stats *snapshot_history = &snapshot->history;
+        if (snapshot_history->keyframes_capacity == 0) {
+            ImGui::Text("History: off, board doesn't fit in %.0f MB", HISTORY_MEMORY_BUDGET / (1024.0 * 1024.0));
+        } else {
+            // Follows the game unless it's being dragged, seeks happen as it moves.
+            if (ImGui::ArrowButton("##history_back", ImGuiDir_Left) && snapshot_history->frame > snapshot_history->first_frame) {
+                seek_game_history(snapshot_history->frame - 1);
+            }
+            ImGui::SameLine();
+            if (ImGui::ArrowButton("##history_forward", ImGuiDir_Right) && snapshot_history->frame < snapshot_history->last_frame) {
+                seek_game_history(snapshot_history->frame + 1);
+            }
+            ImGui::SameLine();
+            if (ImGui::SliderScalar("History", ImGuiDataType_U64, &imgui_history_frame, &snapshot_history->first_frame, &snapshot_history->last_frame)) {
+                seek_game_history(imgui_history_frame);
+            } else if (!ImGui::IsItemActive()) {
+                imgui_history_frame = snapshot_history->frame;
+            }
+            ImGui::Text("History: %llu ticks back, %u/%u keyframes every %u ticks, %.2f/%.2f MB",
+                        (unsigned long long)(snapshot_history->last_frame - snapshot_history->first_frame),
+                        snapshot_history->keyframes, snapshot_history->keyframes_capacity, HISTORY_KEYFRAME_INTERVAL,
+                        snapshot_history->memory_used / (1024.0 * 1024.0), snapshot_history->memory_capacity / (1024.0 * 1024.0));
+        }
+        if (ImGui::Button("Save session")) {
+            save_session();
+        }
+        ImGui::SameLine(); imgui_states[LOAD_SESSION_BUTTON_PRESSED] = ImGui::Button("Load session");
+        ImGui::SameLine(); imgui_states[VERIFY_SAVE_BUTTON_PRESSED] = ImGui::Button("Verify save");
         ImGui::ColorEdit3("Clear color", &screen.clear_color.r);
         ImGui::DragInt2("Move Player", &player_move.x);
         ImGui::SameLine(); imgui_states[MOVE_PLAYER_BUTTON_PRESSED] = ImGui::Button("MoveP");
         ImGui::DragInt2("Move Resource", &resource_move.x);
         ImGui::SameLine(); imgui_states[MOVE_RESOURCE_BUTTON_PRESSED] = ImGui::Button("MoveR");
-        ImGui::DragFloat4("Player Pos[1, 2] / Prev. pos[3, 4]", imgui_playerdrag[0], 1.0f, 0.0f, 0.0f, "%.1f");
+        ImGui::DragInt2("Board Size", &imgui_board_size.x, 1.0f, SIM_BOARD_SIDE_MIN, SIM_BOARD_SIDE_MAX);
+        ImGui::SameLine(); imgui_states[RESIZE_BOARD_BUTTON_PRESSED] = ImGui::Button("Resize");
+        int imgui_tile_max = glm::max(snapshot->width, snapshot->height) - 1;
+        if (ImGui::DragInt2("Player Tile", &imgui_player_tile.x, 1.0f, 0, imgui_tile_max)) {
+            Game_Command command = {};
+            command.kind = GAME_COMMAND_SET_PLAYER_TILE;
+            command.tile = imgui_player_tile;
+            push_game_command(command);
+        }
         ImGui::ColorEdit3("Player Color", &player.color[0]);
         ImGui::ColorEdit3("Player Last Tail Color", &player.last_tail_color[0]);
-        ImGui::DragFloat2("Resource", imgui_resourcedrag[0], 1.0f, 0.0f, 0.0f, "%.1f");
+        if (ImGui::DragInt2("Resource Tile", &imgui_resource_tile.x, 1.0f, 0, imgui_tile_max)) {
+            Game_Command command = {};
+            command.kind = GAME_COMMAND_SET_RESOURCE_TILE;
+            command.tile = imgui_resource_tile;
+            push_game_command(command);
+        }
         ImGui::ColorEdit3("Resource Color", &resource.color[0]);
         ImGui::InputInt("Tail Number X (from 0 to 64)", &imgui_tail_num);
-        ImGui::DragFloat4("Tail #X", imgui_taildrag[imgui_tail_num], 1.0f, 0.0f, 0.0f, "%.1f");
+        if (ImGui::DragInt2("Tail #X", &imgui_tail_tile.x, 1.0f, 0, imgui_tile_max)) {
+            Game_Command command = {};
+            command.kind = GAME_COMMAND_SET_TAIL_TILE;
+            command.tile = imgui_tail_tile;
+            command.index = imgui_tail_num;
+            push_game_command(command);
+        }
         ImGui::ColorEdit3("Tail Color", &tails[imgui_tail_num].color[0]);
         ImGui::NewLine();
         ImGui::Text("GPU Vendor: %s", renderer_info.gpu_vendor);
@@ -478,33 +1144,3 @@ void make_imgui_layout() {
         ImGui::End();
     }
 }
-
-// @Hack @Debug
-void draw_all_tails_on_screen() {
-    ZoneScoped;
-    
-    player.tail_length = PLAYER_TAIL_LENGTH_MAX;
-    int i = 0;
-    for (int row = PLAYABLE_AREA_HEIGHT; row > -PLAYABLE_AREA_HEIGHT-1; row--) {
-        for (int column = -PLAYABLE_AREA_LENGTH; column < PLAYABLE_AREA_LENGTH+1; column++) {
-            move_tail(&tails[i], column, row);
-            // Uncomment next line to see debug output.
-            // printf("Tail[%d] - x: %.1f, y: %.1f\n", i, tails[i].x, tails[i].y);
-            i++;
-        }
-    }
-    printf("[Debug] - Tail moves total: %d\n", i);
-}
-
-Memory_Arena alloc_memory_arena(u64 capacity) {
-    Memory_Arena mem;
-    mem.data = (u8 *) malloc(capacity * sizeof(u8));
-    if (mem.data) {
-        printf("Memory arena successfully allocated at %p.\n", &mem.data[0]);
-    } else {
-        printf("Couldn't allocate memory for memory arena!\n");
-    }
-    mem.capacity = capacity;
-    mem.size = 0;
-    return mem;
-}
@@ -2,15 +2,15 @@
 #define SNAKE_SNAKE_H
 
 #include <assert.h>
-#include <tracy/Tracy.hpp>
 
-#define YPL_TYPES_BY_TYPEDEF
-#define YPL_TYPES_USING_EXACT
-#include "ypl_types.h"
-#include "math.h"
-
-#define For(x) for(int it = 0; it < x; it++)
-#define ForFrom(x, n) for(int it = n; it < x; it++)
+// 'sim.h' brings in Tracy, 'ypl_types.h' and 'math.h'.
+#include "sim.h"
+#include "sim_history.h"
+#include "sim_save.h"
+#include "sim_replay.h"
+#include "logger.h"
+#include "spsc_queue.h"
+#include "triple_buffer.h"
 
 //
 // --- Constants ---
@@ -26,28 +26,64 @@ const float SQUARE_VERTICES[] = {
     -0.5f, -0.5f
 };
 
-const int PLAYABLE_AREA_HEIGHT = 4; // [x, -x] (relative to origin cell)
-const int PLAYABLE_AREA_LENGTH = 7; // [x, -x] (same)
+// Distance between centers of two neighbouring tiles in world space.
+const float TILE_SPACING = 1.2f;
 
-// PLAYER_TAIL_LENGTH_MAX is multiplied by 4 because it counts only 'plane' in XY coords which is [+, +] and gives us 1/4 of a needed result.
-// Because we know bounds are the same in all planes |x, x| we can just multiply by 4 to get the rest of 3/4 of it.
-//
-// Visual example:
-// (signs: [x, y])
-//
-// Y-axis ^
-// [-, +] |  [+, +]
-//  -------------> X-axis
-// [-, -] |  [+, -]
-//        |
-//
-// But then we add some magically formuled number to compensate for
-// calculations we did relative to origin cell. Because of that, center
-// cell would have been sligtly to bottom-right, and the center would have
-// been between 4 squares.
-const int PLAYER_TAIL_LENGTH_MAX = PLAYABLE_AREA_HEIGHT * PLAYABLE_AREA_LENGTH * 4 + (PLAYABLE_AREA_HEIGHT*2 + PLAYABLE_AREA_LENGTH*2) + 1;
+// Scale of the square tile model, applied before translating it to its tile.
+const float TILE_MODEL_SCALE = 100.0f;
+
+// Real-time mode tick rate, independent from the frame rate.
+const int TICK_RATE_MIN_HZ = 1;
+const int TICK_RATE_MAX_HZ = 1000;
+const int TICK_RATE_DEFAULT_HZ = 8;
+
+// Longest frame the tick accumulator catches up on. Anything above that
+// (window dragged, debugger break) is dropped instead of replayed at once.
+const double TICK_CATCH_UP_MAX_SECONDS = 0.25;
+
+// Key presses and edits waiting for the simulation thread, and turns buffered
+// in real-time mode. Turns past the buffer are dropped, so input lag is at most
+// that many ticks.
+const u32 COMMAND_QUEUE_CAPACITY = 64;
+const int TURN_BUFFER_CAPACITY = 3;
+
+// Longest the simulation thread sleeps between checking for commands,
+// so key presses in turn-based mode wait about this long at most.
+const double SIM_THREAD_IDLE_SECONDS = 0.001;
 
-const float TILE_SCALING_FACTOR = 0.8f;
+// Events waiting for each consumer, and how many consumers there can be.
+// A consumer that falls this far behind loses new events, the simulation
+// never waits for it.
+const u32 GAME_EVENT_STREAM_CAPACITY = 256;
+const int GAME_EVENT_STREAMS_MAX = 4;
+
+// Binary log the game writes next to itself, read with 'snake_log_decode'.
+// Records at or above the console level are also printed.
+const char *const GAME_LOG_PATH = "snake.log";
+const u32 GAME_LOG_CONSOLE_LEVEL = LOG_LEVEL_INFO;
+
+// Session saved by 'save_session()' and on exit, loaded by 'load_session()'.
+// Loading skips the checksum of the whole state, 'verify_session()' checks it.
+// Compressed saves are smaller but load by decompressing instead of mapping,
+// 0 writes them as they are.
+const char *const GAME_SAVE_PATH = "snake.save";
+const int GAME_SAVE_COMPRESSION_LEVEL = 0;
+
+// Every game of a session as seeds, inputs and keyframes, checked with
+// 'snake_replay_verify', which also goes to any tick of a game with '-s'.
+// Each session gets a file of its own, named by 'strftime()' from when it
+// started. Recorded compressed, with the dictionary if there is one
+// ('snake_replay_pack train').
+const char *const GAME_REPLAY_NAME_FORMAT = "snake_%Y%m%d_%H%M%S";
+const char *const GAME_REPLAY_EXTENSION = ".replay";
+const char *const GAME_REPLAY_DICTIONARY_PATH = "snake_replay.dict";
+const int GAME_REPLAY_COMPRESSION_LEVEL = SIM_COMPRESSION_LEVEL_DEFAULT;
+
+// Time-travel history takes a keyframe every interval ticks, as many as fit
+// in the budget up to the max. Boards without room for two get no history.
+const u32 HISTORY_KEYFRAME_INTERVAL = 256;
+const u32 HISTORY_KEYFRAMES_MAX = 256;
+const u64 HISTORY_MEMORY_BUDGET = 64ull * 1024 * 1024; // 64MB
 
 const int HOT_MEMORY_ARENA_CAPACITY = 64 * 1024 * sizeof(u8); // 64KB
 const int COLD_MEMORY_ARENA_CAPACITY = 256 * 1024 * sizeof(u8); // 256KB
@@ -63,8 +99,16 @@ struct Tail;
 struct Player;
 struct Resource;
 struct Stats;
-struct Memory_Arena;
+struct Input_Event;
+struct Input_Stats;
+struct History_Stats;
+struct Game_Command;
+struct Game_Event;
+struct Game_Event_Stream;
+struct Game_Snapshot;
 enum Imgui_State;
+enum Game_Command_Kind;
+enum Game_Event_Kind;
 enum Game_State;
 
 struct Camera {
@@ -98,31 +142,20 @@ struct Screen {
     bool fullscreen = false;
 };
 
+// Player, Tail and Resource only hold what rendering needs on top of the
+// simulation. Positions live in 'Sim_State' as packed tile indices and
+// models are made from them while drawing, so moving touches none of this.
 struct Tail {
-    float x = 0.0f;
-    float y = 0.0f;
-    float prev_x = 0.0f;
-    float prev_y = 0.0f;
-    glm::mat4 model = glm::mat4(1.0f);
     glm::vec3 color = glm::vec3(0.96f, 0.39f, 0.26f);
 };
 
 struct Player {
-    float x = 0.0f;
-    float y = 0.0f;
-    float prev_x = 0.0f;
-    float prev_y = 0.0f;
-    glm::mat4 model = glm::mat4(1.0f);
     glm::vec3 color = glm::vec3(0.82f, 0.62f, 0.32f); // RGB
     glm::vec3 last_tail_color = glm::vec3(1.0f, 0.0f, 0.0f); // RGB
-    int tail_length = 0;
     Tail *tails;
 };
 
 struct Resource {
-    float x = 0.0f;
-    float y = 0.0f;
-    glm::mat4 model = glm::mat4(1.0f);
     glm::vec3 color = glm::vec3(0.16f, 1.0f, 0.16f); // RGB
 };
 
@@ -133,6 +166,9 @@ enum Imgui_State {
     DRAW_GLOBALS_WINDOW = 3,
     MOVE_PLAYER_BUTTON_PRESSED = 4,
     MOVE_RESOURCE_BUTTON_PRESSED = 5,
+    RESIZE_BOARD_BUTTON_PRESSED = 6,
+    LOAD_SESSION_BUTTON_PRESSED = 7,
+    VERIFY_SAVE_BUTTON_PRESSED = 8,
 };
 
 struct Stats {
@@ -142,6 +178,107 @@ struct Stats {
     int moves = 0;
 };
 
+// Key press with the time it was seen at, in seconds of 'glfwGetTime()'.
+struct Input_Event {
+    Sim_Input input;
+    double time;
+};
+
+// Latency is the time from a key press until the tick that applied it.
+struct Input_Stats {
+    u64 applied = 0;
+    u64 dropped_reversals = 0;
+    u64 dropped_overflow = 0;
+    double latency_min = 0.0;
+    double latency_max = 0.0;
+    double latency_total = 0.0;
+};
+
+// Frames the history can go back and forth between, see 'Sim_History'.
+struct History_Stats {
+    u64 first_frame = 0;
+    u64 last_frame = 0;
+    u64 frame = 0;
+    u32 keyframes = 0;
+    u32 keyframes_capacity = 0; // 0 when the history is off.
+    u64 memory_used = 0;
+    u64 memory_capacity = 0;
+};
+
+// Everything the main thread asks the simulation to do goes through the
+// command queue, in order, so the simulation state has a single writer.
+enum Game_Command_Kind {
+    GAME_COMMAND_INPUT = 0,             // 'event' is a key press.
+    GAME_COMMAND_RESET = 1,             // New game, the seed is picked by the simulation thread.
+    GAME_COMMAND_WALK_PLAYER = 2,       // Walk by 'tile' squares, one tick per square.
+    GAME_COMMAND_MOVE_RESOURCE = 3,     // Move to 'tile' squares from the origin.
+    GAME_COMMAND_SET_PLAYER_TILE = 4,   // Teleport the head to 'tile'.
+    GAME_COMMAND_SET_RESOURCE_TILE = 5, // Teleport the resource to 'tile'.
+    GAME_COMMAND_SET_TAIL_TILE = 6,     // Teleport tail number 'index' to 'tile'.
+    GAME_COMMAND_RESET_INPUT_STATS = 7,
+    GAME_COMMAND_SEEK_HISTORY = 8,      // Go to history frame 'frame'.
+    GAME_COMMAND_SAVE = 9,              // Save the game as it is at this point, see 'save_session()'.
+};
+
+struct Game_Command {
+    u32 kind;
+    Input_Event event;
+    Vec2i tile;
+    int index;
+    u64 frame;
+};
+
+// What happened in the game, sent by the simulation thread to whoever wants
+// to react to it (log, stats, UI, audio, network) without the simulation
+// calling into them.
+enum Game_Event_Kind {
+    GAME_EVENT_RESET = 0,           // New game started with 'seed'.
+    GAME_EVENT_RESOURCE_PICKED = 1, // Player ate the resource at 'tile'.
+    GAME_EVENT_RESOURCE_MOVED = 2,  // Resource was moved to 'tile' by hand.
+    GAME_EVENT_DIED = 3,            // Head ran into 'tile', which is a wall or a tail.
+    GAME_EVENT_WON = 4,             // Player took every tile, 'tile' is where the head ended.
+};
+
+// State is the one right after the event, 'tick' counts from the game's reset.
+struct Game_Event {
+    u32 kind;
+    u64 tick;
+    Vec2i tile;
+    int score;
+    int moves;
+    u64 seed;
+    double time; // Simulation thread's clock.
+};
+
+// One consumer's copy of the events. The simulation pushes every event into
+// every open stream and drops it, counting, for a stream that's full, so a
+// slow consumer only ever loses its own events. Streams stay open for the
+// rest of the session once opened.
+struct Game_Event_Stream {
+    Spsc_Queue<Game_Event, GAME_EVENT_STREAM_CAPACITY> queue;
+    std::atomic<bool> open{false};
+    std::atomic<u64> dropped{0};
+};
+
+// What the renderer needs from one simulation state, copied out by the
+// simulation thread. Published snapshots are never written again until
+// the reader lets go of them, so drawing one needs no locks.
+// 'tiles' holds 'length' tile indices, head first, and is sized for the board.
+struct Game_Snapshot {
+    int width;
+    int height;
+    u32 resource;
+    int length;
+    u32 *tiles;
+    int score;
+    int moves;
+    u64 tick;
+    u64 seed;
+    u64 hash; // Zobrist hash of the position, see 'Sim_State'.
+    Input_Stats input_stats;
+    History_Stats history;
+};
+
 enum Game_State {
     PLAY = (1 << 0),
     DEBUG = (1 << 1),
@@ -150,12 +287,6 @@ enum Game_State {
     SETTINGS_SCREEN = (1 << 4),
 };
 
-struct Memory_Arena {
-    u8 *data;
-    u64 capacity;
-    u64 size;
-};
-
 template <typename T>
 struct Array {
     T *data;
@@ -166,29 +297,46 @@ struct Array {
 //
 // --- Functions ---
 //
-void game_tick();
-void game_reset();
+void game_tick(Sim_Input input);
+void game_reset(u64 seed);
+void request_game_reset();
+void seek_game_history(u64 frame);
+bool resize_game_board(int width, int height);
+void restart_game_on_board(Vec2i size);
+void start_sim_thread();
+void stop_sim_thread();
+void publish_game_snapshot();
+Vec2i get_snapshot_tile(Game_Snapshot *snapshot, u32 index);
+u64 get_new_game_seed();
 void game_over();
 void game_save();
 void save_session();
+void load_session();
+void verify_session();
+bool load_game_save();
+void wait_for_game_save();
+void open_game_replay();
 void game_exit();
 void store_stats(Stats *stats);
-void move_player(Player *player, int squares_right, int squares_up);
-void move_resource_from_origin(Resource *resource, int squares_right, int squares_up);
-void move_resource_to_rand_pos(Resource *resource, Player *player);
-void move_tail(Tail *tail, int squares_right, int squares_up);
-void move_player_tails(Player *player);
-Vec2f new_random_pos(int squares_up_max, int squares_right_max);
-Vec2f new_random_resource_pos(Resource *resoucre, int max_tile_x, int max_tile_y, Vec2f *not_valid_tiles, int tiles_size);
+void push_game_command(Game_Command command);
+Game_Event_Stream *open_game_event_stream();
+void emit_game_event(u32 kind, Vec2i tile);
+bool pop_game_event(Game_Event_Stream *stream, Game_Event *event);
+void print_game_events();
+void move_player(Sim_Input input);
+int update_game_ticks(double now);
+void move_resource_from_origin(int squares_right, int squares_up);
+glm::mat4 get_tile_model(float x, float y);
+glm::mat4 get_tile_model(Vec2i tile);
+float get_board_zoom();
 inline Vec2f get_tile_coords(int x, int y);
 inline Vec2f get_tile_coords(Vec2i tile);
 inline Vec2i get_coords_tile(float x, float y);
 inline Vec2i get_coords_tile(Vec2f coords);
 void make_tails_color_step_gradient(Tail *tails, int length, glm::vec3 start_color, float step_r, float step_g, float step_b);
 void make_tails_color_linear_gradient(Tail *tails, int length, glm::vec3 start_color, glm::vec3 end_color, float offset_from_middle);
+void update_tails_color_gradient();
 void make_imgui_layout();
-void draw_all_tails_on_screen();
-Memory_Arena alloc_memory_arena(u64 capacity);
 
 template <typename T>
 void array_add(Array<T> *array, T item);
@@ -0,0 +1,73 @@
+#ifndef SNAKE_SPSC_QUEUE_H
+#define SNAKE_SPSC_QUEUE_H
+
+// Lock-free single-producer single-consumer ring buffer.
+//
+// Exactly one thread may push and exactly one thread may pop, which can be
+// the same thread. Neither side ever blocks: push fails when the queue is
+// full and pop fails when it's empty.
+
+#include <atomic>
+
+#define YPL_TYPES_BY_TYPEDEF
+#define YPL_TYPES_USING_EXACT
+#include "ypl_types.h"
+
+//
+// --- Structs ---
+//
+
+// 'head' and 'tail' only ever grow and wrap around u32, slots are picked
+// by masking, so Capacity must be a power of two. Each side writes only
+// its own index, and they live on separate cache lines so the producer
+// and the consumer don't keep stealing the line from each other.
+template <typename T, u32 Capacity>
+struct Spsc_Queue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Spsc_Queue capacity must be a power of two");
+
+    alignas(64) std::atomic<u32> head{0}; // Next item to pop, written by the consumer.
+    alignas(64) std::atomic<u32> tail{0}; // Next free slot, written by the producer.
+    alignas(64) T items[Capacity];
+};
+
+//
+// --- Functions ---
+//
+
+// Producer only. Returns false when the queue is full.
+template <typename T, u32 Capacity>
+bool spsc_push(Spsc_Queue<T, Capacity> *queue, const T &item) {
+    u32 tail = queue->tail.load(std::memory_order_relaxed);
+    u32 head = queue->head.load(std::memory_order_acquire);
+    if (tail - head == Capacity) {
+        return false;
+    }
+
+    queue->items[tail & (Capacity - 1)] = item;
+    queue->tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+// Consumer only. Returns false when the queue is empty.
+template <typename T, u32 Capacity>
+bool spsc_pop(Spsc_Queue<T, Capacity> *queue, T *item) {
+    u32 head = queue->head.load(std::memory_order_relaxed);
+    u32 tail = queue->tail.load(std::memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+
+    *item = queue->items[head & (Capacity - 1)];
+    queue->head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+// Either side. Only a snapshot, the other side may change it right away.
+template <typename T, u32 Capacity>
+u32 spsc_count(Spsc_Queue<T, Capacity> *queue) {
+    u32 tail = queue->tail.load(std::memory_order_acquire);
+    u32 head = queue->head.load(std::memory_order_acquire);
+    return tail - head;
+}
+
+#endif /*SNAKE_SPSC_QUEUE_H*/
@@ -0,0 +1,65 @@
+#ifndef SNAKE_TRIPLE_BUFFER_H
+#define SNAKE_TRIPLE_BUFFER_H
+
+// Lock-free handoff of the latest value from one writer thread to one
+// reader thread.
+//
+// The writer fills its 'back' buffer and publishes it by swapping it with
+// the shared 'middle' one. The reader swaps 'middle' with its 'front' buffer
+// when something new was published. Neither side ever waits, the reader
+// always gets the newest complete value, and the buffer the reader holds is
+// never written until it lets go of it on the next acquire.
+
+#include <atomic>
+
+#define YPL_TYPES_BY_TYPEDEF
+#define YPL_TYPES_USING_EXACT
+#include "ypl_types.h"
+
+//
+// --- Constants ---
+//
+const u32 TRIPLE_BUFFER_INDEX_MASK = 3;
+const u32 TRIPLE_BUFFER_FRESH = 4; // Set in 'middle' when it holds something the reader hasn't seen.
+
+//
+// --- Structs ---
+//
+template <typename T>
+struct Triple_Buffer {
+    T buffers[3];
+    alignas(64) std::atomic<u32> middle{1};
+    alignas(64) u32 back = 0;  // Writer only.
+    alignas(64) u32 front = 2; // Reader only.
+};
+
+//
+// --- Functions ---
+//
+
+// Writer only. Buffer to fill before the next publish, it holds whatever
+// was written there two publishes ago.
+template <typename T>
+T *triple_buffer_back(Triple_Buffer<T> *buffer) {
+    return &buffer->buffers[buffer->back];
+}
+
+// Writer only.
+template <typename T>
+void triple_buffer_publish(Triple_Buffer<T> *buffer) {
+    u32 old_middle = buffer->middle.exchange(buffer->back | TRIPLE_BUFFER_FRESH, std::memory_order_acq_rel);
+    buffer->back = old_middle & TRIPLE_BUFFER_INDEX_MASK;
+}
+
+// Reader only. Newest published value, stays valid and unchanged
+// until the next call.
+template <typename T>
+T *triple_buffer_acquire(Triple_Buffer<T> *buffer) {
+    if (buffer->middle.load(std::memory_order_relaxed) & TRIPLE_BUFFER_FRESH) {
+        u32 old_middle = buffer->middle.exchange(buffer->front, std::memory_order_acq_rel);
+        buffer->front = old_middle & TRIPLE_BUFFER_INDEX_MASK;
+    }
+    return &buffer->buffers[buffer->front];
+}
+
+#endif /*SNAKE_TRIPLE_BUFFER_H*/